@@ -0,0 +1,218 @@
+#include <exec/types.h>
+#include <exec/memory.h>
+#include <proto/exec.h>
+#include <proto/dos.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "radio.h"
+#include "radio_log.h"
+#include "radio_lz.h"
+#include "radio_stats.h"
+
+#define BLOCK_BYTES (BLOCK_ENTRIES * sizeof(struct RadioEntry))
+#define PACKED_BYTES LZ_BOUND(BLOCK_BYTES)
+#define MAX_FILENAME 108
+
+// The block table of the last file load_block_entry was asked about and
+// its most recently used block. Scans walk the entries in order, so each
+// block is read and decompressed once.
+static struct {
+    char filename[MAX_FILENAME];
+    BOOL blocked;
+    ULONG num_entries;
+    ULONG num_blocks;
+    ULONG *offsets;
+    UBYTE *packed;
+    UBYTE *data;
+    LONG current;
+} cache;
+
+static ULONG table_size(ULONG num_blocks) {
+    return sizeof(ULONG) * (num_blocks + 1);
+}
+
+BOOL save_blocked_format(const char *filename, struct RadioEntry *entries, ULONG num_entries,
+                         const struct CatalogBuild *build) {
+    struct CatalogHeader header;
+    BOOL success = FALSE;
+    ULONG num_blocks = (num_entries + BLOCK_ENTRIES - 1) / BLOCK_ENTRIES;
+
+    log_info("Saving compressed binary file: %s (entries: %lu)\n", filename, (unsigned long)num_entries);
+
+    catalog_header(&header, BLOCK_MAGIC, sizeof(struct RadioEntry), num_entries, build);
+
+    ULONG offsets_size = table_size(num_blocks);
+    ULONG *offsets = radio_alloc(offsets_size, MEMF_CLEAR);
+    UBYTE *packed = radio_alloc(PACKED_BYTES, MEMF_ANY);
+    BPTR file = radio_open(filename, MODE_NEWFILE);
+
+    if (!offsets || !packed || !file) {
+        log_error("Failed to create compressed binary file\n");
+        goto done;
+    }
+
+    // The header is written again once the checksum is known
+    if (radio_write(file, &header, sizeof(header)) != sizeof(header)) {
+        log_error("Failed to write compressed binary header\n");
+        goto done;
+    }
+
+    ULONG position = sizeof(header);
+    for (ULONG block = 0; block < num_blocks; block++) {
+        ULONG first = block * BLOCK_ENTRIES;
+        ULONG count = num_entries - first < BLOCK_ENTRIES ? num_entries - first : BLOCK_ENTRIES;
+        ULONG length = lz_compress((const UBYTE *)&entries[first],
+                                   count * sizeof(struct RadioEntry), packed);
+
+        if (length == 0 || radio_write(file, packed, length) != (LONG)length) {
+            log_error("Failed to write block %lu\n", block);
+            goto done;
+        }
+        header.checksum = crc32(header.checksum, packed, length);
+        offsets[block] = position;
+        position += length;
+        log_trace("Block %lu: %lu entries in %lu bytes\n", block, count, length);
+    }
+    offsets[num_blocks] = position;
+    header.checksum = crc32(header.checksum, offsets, offsets_size);
+
+    if (radio_write(file, offsets, offsets_size) != (LONG)offsets_size ||
+        radio_seek(file, 0, OFFSET_BEGINNING) == -1 ||
+        radio_write(file, &header, sizeof(header)) != sizeof(header)) {
+        log_error("Failed to write block table\n");
+        goto done;
+    }
+
+    log_info("Compressed %lu bytes to %lu bytes\n",
+             sizeof(struct RadioEntry) * num_entries, position + offsets_size);
+    success = TRUE;
+
+done:
+    if (file) radio_close(file);
+    if (packed) radio_free(packed, PACKED_BYTES);
+    if (offsets) radio_free(offsets, offsets_size);
+    return success;
+}
+
+static void free_buffers(void) {
+    if (cache.offsets) radio_free(cache.offsets, table_size(cache.num_blocks));
+    if (cache.packed) radio_free(cache.packed, PACKED_BYTES);
+    if (cache.data) radio_free(cache.data, BLOCK_BYTES);
+    cache.offsets = NULL;
+    cache.packed = NULL;
+    cache.data = NULL;
+}
+
+void block_file_close(void) {
+    free_buffers();
+    memset(&cache, 0, sizeof(cache));
+}
+
+// Reads the header of filename once and keeps the block table if it has
+// one. A damaged compressed file still counts as compressed, so its
+// entries fail to load instead of being read as plain records.
+BOOL is_blocked_file(const char *filename) {
+    struct CatalogHeader header;
+
+    if (cache.filename[0] && strcmp(cache.filename, filename) == 0) {
+        return cache.blocked;
+    }
+
+    block_file_close();
+    strncpy(cache.filename, filename, MAX_FILENAME - 1);
+    cache.current = -1;
+
+    BPTR file = radio_open(filename, MODE_OLDFILE);
+    if (!file) return FALSE;
+
+    // Anything else is left to the plain record reader
+    if (radio_read(file, &header, sizeof(header)) != sizeof(header) ||
+        header.magic != BLOCK_MAGIC) {
+        radio_close(file);
+        return FALSE;
+    }
+
+    cache.blocked = TRUE;
+    if (header.version != CATALOG_VERSION || header.record_size != sizeof(struct RadioEntry)) {
+        log_error("Unsupported compressed binary file: %s\n", filename);
+        radio_close(file);
+        return TRUE;
+    }
+
+    cache.num_entries = header.num_entries;
+    cache.num_blocks = (header.num_entries + BLOCK_ENTRIES - 1) / BLOCK_ENTRIES;
+
+    // The block table is at the end of the file and ends with its own offset
+    ULONG offsets_size = table_size(cache.num_blocks);
+    cache.offsets = radio_alloc(offsets_size, MEMF_ANY);
+    cache.packed = radio_alloc(PACKED_BYTES, MEMF_ANY);
+    cache.data = radio_alloc(BLOCK_BYTES, MEMF_ANY);
+
+    LONG table_start = -1;
+    if (cache.offsets && cache.packed && cache.data &&
+        radio_seek(file, -(LONG)offsets_size, OFFSET_END) != -1) {
+        table_start = radio_seek(file, 0, OFFSET_CURRENT);
+    }
+
+    if (table_start < (LONG)sizeof(header) ||
+        radio_read(file, cache.offsets, offsets_size) != (LONG)offsets_size ||
+        cache.offsets[cache.num_blocks] != (ULONG)table_start) {
+        log_error("Failed to read block table of %s\n", filename);
+        radio_close(file);
+        free_buffers();
+        return TRUE;
+    }
+
+    radio_close(file);
+    log_trace("%s: %lu entries in %lu blocks\n", filename, cache.num_entries, cache.num_blocks);
+    return TRUE;
+}
+
+static BOOL load_block(ULONG block) {
+    ULONG length = cache.offsets[block + 1] - cache.offsets[block];
+    ULONG first = block * BLOCK_ENTRIES;
+    ULONG count = cache.num_entries - first < BLOCK_ENTRIES ? cache.num_entries - first : BLOCK_ENTRIES;
+
+    if (cache.offsets[block + 1] < cache.offsets[block] || length > PACKED_BYTES ||
+        cache.offsets[block] < sizeof(struct CatalogHeader)) {
+        log_error("Bad block table entry %lu\n", block);
+        return FALSE;
+    }
+
+    BPTR file = radio_open(cache.filename, MODE_OLDFILE);
+    if (!file) {
+        log_error("Failed to open data file: %s\n", cache.filename);
+        return FALSE;
+    }
+
+    LONG bytes_read = -1;
+    if (radio_seek(file, cache.offsets[block], OFFSET_BEGINNING) != -1) {
+        bytes_read = radio_read(file, cache.packed, length);
+    }
+    radio_close(file);
+
+    if (bytes_read != (LONG)length ||
+        !lz_decompress(cache.packed, length, cache.data, count * sizeof(struct RadioEntry))) {
+        log_error("Failed to read block %lu of %s\n", block, cache.filename);
+        cache.current = -1;
+        return FALSE;
+    }
+
+    cache.current = block;
+    return TRUE;
+}
+
+struct RadioEntry *load_block_entry(const char *filename, ULONG entry) {
+    if (!is_blocked_file(filename) || !cache.offsets) return NULL;
+
+    if (entry >= cache.num_entries) {
+        log_error("Entry %lu beyond end of %s\n", entry, filename);
+        return NULL;
+    }
+
+    ULONG block = entry / BLOCK_ENTRIES;
+    if ((LONG)block != cache.current && !load_block(block)) return NULL;
+
+    return (struct RadioEntry *)cache.data + entry % BLOCK_ENTRIES;
+}
@@ -0,0 +1,144 @@
+#include <exec/types.h>
+#include <exec/memory.h>
+#include <proto/exec.h>
+#include <proto/dos.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "radio.h"
+#include "radio_log.h"
+#include "radio_stats.h"
+
+#define CRC_POLY 0xEDB88320UL
+#define VERIFY_CHUNK 4096
+
+static ULONG crc_table[256];
+
+static void make_crc_table(void) {
+    for (ULONG n = 0; n < 256; n++) {
+        ULONG c = n;
+        for (int k = 0; k < 8; k++) {
+            c = c & 1 ? CRC_POLY ^ (c >> 1) : c >> 1;
+        }
+        crc_table[n] = c;
+    }
+}
+
+ULONG crc32(ULONG crc, const void *data, ULONG length) {
+    const UBYTE *p = data;
+
+    if (crc_table[1] == 0) make_crc_table();
+
+    // The mask keeps the result a CRC-32 where ULONG is wider
+    crc = ~crc & 0xFFFFFFFFUL;
+    while (length--) {
+        crc = crc_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc & 0xFFFFFFFFUL;
+}
+
+void catalog_build(struct CatalogBuild *build, struct RadioEntry *entries, ULONG num_entries) {
+    struct DateStamp now;
+
+    DateStamp(&now);
+    build->stamp = now.ds_Days * 86400 + now.ds_Minute * 60 + now.ds_Tick / TICKS_PER_SECOND;
+    build->data_checksum = crc32(0, entries, sizeof(struct RadioEntry) * num_entries);
+}
+
+void catalog_header(struct CatalogHeader *header, ULONG magic, UWORD record_size,
+                    ULONG num_entries, const struct CatalogBuild *build) {
+    header->magic = magic;
+    header->version = CATALOG_VERSION;
+    header->record_size = record_size;
+    header->num_entries = num_entries;
+    header->build_stamp = build->stamp;
+    header->data_checksum = build->data_checksum;
+    header->checksum = 0;
+}
+
+BOOL read_catalog_header(BPTR file, const char *filename, ULONG magic, UWORD record_size,
+                         struct CatalogHeader *header) {
+    if (radio_read(file, header, sizeof(*header)) != sizeof(*header)) {
+        log_error("%s: too short for a catalog header\n", filename);
+        return FALSE;
+    }
+    if (header->magic != magic) {
+        log_error("%s: not a catalog file, rebuild it with radioparser\n", filename);
+        return FALSE;
+    }
+    if (header->version != CATALOG_VERSION || header->record_size != record_size) {
+        log_error("%s: format version %u with %u byte records, expected %u with %u\n",
+                  filename, header->version, header->record_size, CATALOG_VERSION, record_size);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// Seek() returns the previous position, so the size comes from the second
+// call, which also leaves the file at the first record
+BOOL check_catalog_size(BPTR file, const char *filename, const struct CatalogHeader *header) {
+    radio_seek(file, 0, OFFSET_END);
+    LONG size = radio_seek(file, sizeof(*header), OFFSET_BEGINNING) - (LONG)sizeof(*header);
+
+    if (size < 0 || size % header->record_size != 0 ||
+        (ULONG)size / header->record_size != header->num_entries) {
+        log_error("%s has %ld bytes of records, header says %lu records\n",
+                  filename, size, header->num_entries);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+BOOL catalog_matches(const struct CatalogHeader *a, const struct CatalogHeader *b) {
+    return a->num_entries == b->num_entries && a->build_stamp == b->build_stamp &&
+           a->data_checksum == b->data_checksum;
+}
+
+BOOL check_data_file(const char *filename, const struct CatalogHeader *index_header, BOOL verify) {
+    static UBYTE buffer[VERIFY_CHUNK];
+    struct CatalogHeader header;
+    BOOL success = FALSE;
+
+    BPTR file = radio_open(filename, MODE_OLDFILE);
+    if (!file) {
+        log_error("Failed to open data file: %s\n", filename);
+        return FALSE;
+    }
+
+    // Either layout will do, both carry the same build stamp
+    if (radio_read(file, &header, sizeof(header)) != sizeof(header) ||
+        (header.magic != DATA_MAGIC && header.magic != BLOCK_MAGIC)) {
+        log_error("%s: not a catalog file, rebuild it with radioparser\n", filename);
+        goto done;
+    }
+    if (header.version != CATALOG_VERSION || header.record_size != sizeof(struct RadioEntry)) {
+        log_error("%s: format version %u with %u byte records, expected %u with %u\n",
+                  filename, header.version, header.record_size, CATALOG_VERSION,
+                  (UWORD)sizeof(struct RadioEntry));
+        goto done;
+    }
+    if (!catalog_matches(&header, index_header)) {
+        log_error("%s and the index come from different radioparser runs, run it again\n",
+                  filename);
+        goto done;
+    }
+
+    if (verify) {
+        ULONG crc = 0;
+        LONG length;
+        while ((length = radio_read(file, buffer, sizeof(buffer))) > 0) {
+            crc = crc32(crc, buffer, length);
+        }
+        if (length < 0 || crc != header.checksum) {
+            log_error("%s: checksum mismatch, the file is damaged\n", filename);
+            goto done;
+        }
+        log_info("%s: checksum %08lx verified\n", filename, crc);
+    }
+
+    success = TRUE;
+
+done:
+    radio_close(file);
+    return success;
+}
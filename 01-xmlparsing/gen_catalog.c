@@ -0,0 +1,191 @@
+// Synthetic Icecast directory generator for benchmarking radioparser and
+// radiosearch. Plain C and stdio only, so it builds for the Amiga and for
+// the host (see the "host" target in the Makefile). The output is the same
+// for a given entry count and seed.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_ENTRIES 1
+#define MAX_ENTRIES 1000000
+
+struct Weighted {
+    const char *value;
+    unsigned int weight;
+};
+
+// Genres roughly follow the long tail of a real directory
+static const struct Weighted genres[] = {
+    {"pop", 180}, {"rock", 150}, {"dance", 90}, {"news", 70}, {"jazz", 60},
+    {"classical", 55}, {"electronic", 55}, {"hiphop", 50}, {"talk", 45},
+    {"country", 40}, {"oldies", 35}, {"ambient", 30}, {"metal", 25},
+    {"reggae", 20}, {"blues", 18}, {"latin", 18}, {"soul", 15}, {"folk", 12},
+    {"chillout", 12}, {"trance", 10}, {"house", 10}, {"techno", 10},
+    {"punk", 6}, {"gospel", 5}, {"chiptune", 3}, {"demoscene", 2}, {"misc", 20}
+};
+
+static const struct Weighted bitrates[] = {
+    {"32", 4}, {"48", 4}, {"64", 14}, {"96", 10}, {"112", 2}, {"128", 45},
+    {"160", 3}, {"192", 10}, {"256", 5}, {"320", 3}
+};
+
+static const struct Weighted types[] = {
+    {"audio/mpeg", 75}, {"audio/aacp", 15}, {"application/ogg", 8}, {"audio/aac", 2}
+};
+
+static const struct Weighted samplerates[] = {
+    {"44100", 85}, {"48000", 10}, {"22050", 4}, {"32000", 1}
+};
+
+static const struct Weighted channels[] = {
+    {"2", 90}, {"1", 10}
+};
+
+static const char *prefixes[] = {
+    "Radio", "Classic", "Smooth", "Planet", "Absolute", "Kiss", "Magic",
+    "Heart", "Capital", "Star", "Sunshine", "Retro", "Deep", "Pure", "Big",
+    "Amiga", "Power", "Cool", "Hit", "Free"
+};
+
+static const char *places[] = {
+    "London", "Berlin", "Warsaw", "Paris", "Madrid", "Rome", "Oslo", "Dublin",
+    "Vienna", "Prague", "Krakow", "Boston", "Chicago", "Denver", "Austin",
+    "Seattle", "Tokyo", "Sydney", "Toronto", "Lisbon", "Athens", "Helsinki"
+};
+
+static const char *suffixes[] = {
+    "FM", "Radio", "Stream", "Hits", "Live", "One", "24/7", "Online", "AM",
+    "Sound", "Waves", "Beats"
+};
+
+static const char *artists[] = {
+    "The Jets", "Nova", "Mira Kalt", "Orbital Drift", "Lena Berg", "Sonic Youth Club",
+    "DJ Paula", "Chip Ensemble", "Ivory Keys", "Blue Harbour", "The Copper Lines"
+};
+
+static const char *titles[] = {
+    "Night Drive", "Open Skies", "Golden Hour", "Static", "Paper Planes",
+    "Long Way Home", "Echoes", "Midnight Run", "Silver Rain", "Guru Meditation"
+};
+
+static unsigned long rng_state;
+
+// xorshift32: fast and identical on every platform
+static unsigned long next_random(void) {
+    unsigned long x = rng_state;
+    x ^= (x << 13) & 0xffffffffUL;
+    x ^= x >> 17;
+    x ^= (x << 5) & 0xffffffffUL;
+    rng_state = x & 0xffffffffUL;
+    return rng_state;
+}
+
+static unsigned long pick(unsigned long n) {
+    return next_random() % n;
+}
+
+static const char *pick_weighted(const struct Weighted *table, unsigned int count) {
+    unsigned int total = 0;
+    unsigned int i;
+
+    for (i = 0; i < count; i++) total += table[i].weight;
+
+    unsigned long r = pick(total);
+    for (i = 0; i < count; i++) {
+        if (r < table[i].weight) return table[i].value;
+        r -= table[i].weight;
+    }
+    return table[count - 1].value;
+}
+
+#define COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+// Every random pick gets its own statement: argument evaluation order
+// differs between compilers and would change the output
+static void write_entry(FILE *out, unsigned long n) {
+    const char *genre = pick_weighted(genres, COUNT(genres));
+    const char *prefix = prefixes[pick(COUNT(prefixes))];
+    const char *place = places[pick(COUNT(places))];
+    const char *suffix = suffixes[pick(COUNT(suffixes))];
+    char name[64];
+
+    // Mix of "Radio Berlin", "Kiss FM Dublin", genre named and numbered stations
+    switch (pick(4)) {
+    case 0:
+        sprintf(name, "%s %s", prefix, place);
+        break;
+    case 1:
+        sprintf(name, "%s %s %s", prefix, suffix, place);
+        break;
+    case 2:
+        sprintf(name, "%s %s %s", place, genre, suffix);
+        break;
+    default:
+        sprintf(name, "%s %s %lu", prefix, suffix, n % 1000);
+        break;
+    }
+
+    unsigned long host = pick(500);
+    unsigned long port = 8000 + pick(100);
+    const char *type = pick_weighted(types, COUNT(types));
+    const char *bitrate = pick_weighted(bitrates, COUNT(bitrates));
+    const char *samplerate = pick_weighted(samplerates, COUNT(samplerates));
+    const char *channel_count = pick_weighted(channels, COUNT(channels));
+
+    fprintf(out, "<entry>\n");
+    fprintf(out, "<server_name>%s</server_name>\n", name);
+    fprintf(out, "<listen_url>http://stream%lu.example.net:%lu/%s%lu.mp3</listen_url>\n",
+            host, port, genre, n);
+    fprintf(out, "<server_type>%s</server_type>\n", type);
+    fprintf(out, "<bitrate>%s</bitrate>\n", bitrate);
+    fprintf(out, "<samplerate>%s</samplerate>\n", samplerate);
+    fprintf(out, "<channels>%s</channels>\n", channel_count);
+    fprintf(out, "<genre>%s</genre>\n", genre);
+
+    // About a third of the stations send no song title
+    if (pick(3)) {
+        const char *artist = artists[pick(COUNT(artists))];
+        const char *title = titles[pick(COUNT(titles))];
+        fprintf(out, "<current_song>%s - %s</current_song>\n", artist, title);
+    } else {
+        fprintf(out, "<current_song></current_song>\n");
+    }
+    fprintf(out, "</entry>\n");
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3 || argc > 4) {
+        printf("Usage: %s <entries> <xml_file> [seed]\n", argv[0]);
+        printf("Writes %d to %d synthetic directory entries\n", MIN_ENTRIES, MAX_ENTRIES);
+        return 1;
+    }
+
+    long count = atol(argv[1]);
+    if (count < MIN_ENTRIES || count > MAX_ENTRIES) {
+        printf("Entry count must be between %d and %d\n", MIN_ENTRIES, MAX_ENTRIES);
+        return 1;
+    }
+
+    rng_state = argc == 4 ? strtoul(argv[3], NULL, 10) : 0x414d4947UL;
+    if (rng_state == 0) rng_state = 1;
+
+    FILE *out = fopen(argv[2], "w");
+    if (!out) {
+        printf("Could not create %s\n", argv[2]);
+        return 2;
+    }
+
+    fprintf(out, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<directory>\n");
+    for (long n = 0; n < count; n++) {
+        write_entry(out, (unsigned long)n);
+    }
+    fprintf(out, "</directory>\n");
+
+    if (fclose(out) != 0) {
+        printf("Failed to write %s\n", argv[2]);
+        return 2;
+    }
+
+    printf("Wrote %ld entries to %s\n", count, argv[2]);
+    return 0;
+}
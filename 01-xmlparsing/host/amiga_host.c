@@ -0,0 +1,196 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "amiga_host.h"
+
+// AvailMem() reports this much less what AllocMem() handed out, so the
+// memory radiobench sees held is what the catalog code allocated
+#define HOST_MEMORY (256UL * 1024 * 1024)
+#define PROGDIR "PROGDIR:"
+#define MAX_SPEC 32
+
+// 1978-01-01, the start of the AmigaDOS calendar, in Unix time
+#define AMIGA_EPOCH 252460800L
+
+static ULONG allocated = 0;
+static FILE *output = NULL;
+static struct Device timer_device = {TIMERNAME};
+
+// Take a copy of stdout before the program gets to reopen it
+__attribute__((constructor)) static void open_output(void) {
+    int fd = dup(STDOUT_FILENO);
+    output = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (!output) output = stdout;
+}
+
+APTR AllocMem(ULONG size, ULONG requirements) {
+    APTR memory = requirements & MEMF_CLEAR ? calloc(1, size) : malloc(size);
+    if (memory) allocated += size;
+    return memory;
+}
+
+void FreeMem(APTR memory, ULONG size) {
+    free(memory);
+    allocated -= size;
+}
+
+ULONG AvailMem(ULONG requirements) {
+    (void)requirements;
+    return allocated < HOST_MEMORY ? HOST_MEMORY - allocated : 0;
+}
+
+void CopyMem(const void *source, APTR dest, ULONG size) {
+    memcpy(dest, source, size);
+}
+
+BYTE OpenDevice(CONST_STRPTR name, ULONG unit, struct IORequest *request, ULONG flags) {
+    (void)unit;
+    (void)flags;
+    if (strcmp(name, TIMERNAME) != 0) return -1;
+
+    request->io_Device = &timer_device;
+    return 0;
+}
+
+void CloseDevice(struct IORequest *request) {
+    request->io_Device = NULL;
+}
+
+static const char *host_name(CONST_STRPTR name) {
+    return strncmp(name, PROGDIR, strlen(PROGDIR)) == 0 ? name + strlen(PROGDIR) : name;
+}
+
+BPTR Open(CONST_STRPTR name, LONG mode) {
+    const char *path = host_name(name);
+    FILE *file = NULL;
+
+    switch (mode) {
+    case MODE_OLDFILE:
+        file = fopen(path, "rb");
+        break;
+    case MODE_NEWFILE:
+        file = fopen(path, "w+b");
+        break;
+    case MODE_READWRITE:
+        file = fopen(path, "r+b");
+        if (!file) file = fopen(path, "w+b");
+        break;
+    }
+    return (BPTR)file;
+}
+
+BOOL Close(BPTR file) {
+    return fclose((FILE *)file) == 0;
+}
+
+LONG Read(BPTR file, APTR buffer, LONG length) {
+    size_t got = fread(buffer, 1, length, (FILE *)file);
+    return got == 0 && ferror((FILE *)file) ? -1 : (LONG)got;
+}
+
+LONG Write(BPTR file, const void *buffer, LONG length) {
+    size_t put = fwrite(buffer, 1, length, (FILE *)file);
+    return put == 0 && length > 0 ? -1 : (LONG)put;
+}
+
+// Like dos.library, returns the position before the seek
+LONG Seek(BPTR file, LONG position, LONG mode) {
+    FILE *f = (FILE *)file;
+    int whence = mode == OFFSET_BEGINNING ? SEEK_SET : mode == OFFSET_END ? SEEK_END : SEEK_CUR;
+
+    LONG previous = ftell(f);
+    if (previous < 0 || fseek(f, position, whence) != 0) return -1;
+    return previous;
+}
+
+BOOL DeleteFile(CONST_STRPTR name) {
+    return remove(host_name(name)) == 0;
+}
+
+// dos.library will not replace an existing file
+BOOL Rename(CONST_STRPTR from, CONST_STRPTR to) {
+    struct stat st;
+    if (stat(host_name(to), &st) == 0) return FALSE;
+    return rename(host_name(from), host_name(to)) == 0;
+}
+
+struct DateStamp *DateStamp(struct DateStamp *date) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    LONG seconds = (LONG)now.tv_sec - AMIGA_EPOCH;
+    date->ds_Days = seconds / 86400;
+    date->ds_Minute = seconds % 86400 / 60;
+    date->ds_Tick = seconds % 60 * TICKS_PER_SECOND + now.tv_nsec / (1000000000L / TICKS_PER_SECOND);
+    return date;
+}
+
+// RawDoFmt style: every argument takes one LONG, %s gets a pointer
+LONG VPrintf(CONST_STRPTR format, const LONG *args) {
+    char spec[MAX_SPEC];
+    LONG count = 0;
+
+    for (const char *p = format; *p; p++) {
+        if (*p != '%') {
+            fputc(*p, output);
+            count++;
+            continue;
+        }
+        if (p[1] == '%') {
+            fputc('%', output);
+            count++;
+            p++;
+            continue;
+        }
+
+        // Flags, width and precision are kept, the length modifier is not
+        size_t length = 0;
+        spec[length++] = *p++;
+        while (*p && strchr("-+ #0123456789.", *p) && length < MAX_SPEC - 3) spec[length++] = *p++;
+        while (*p == 'l') p++;
+        if (!*p) break;
+
+        int written;
+        if (*p == 's') {
+            spec[length++] = 's';
+            spec[length] = '\0';
+            written = fprintf(output, spec, (const char *)*args++);
+        } else if (*p == 'c') {
+            spec[length++] = 'c';
+            spec[length] = '\0';
+            written = fprintf(output, spec, (int)*args++);
+        } else {
+            spec[length++] = 'l';
+            spec[length++] = *p;
+            spec[length] = '\0';
+            written = strchr("di", *p) ? fprintf(output, spec, *args++)
+                                       : fprintf(output, spec, (ULONG)*args++);
+        }
+        if (written > 0) count += written;
+    }
+
+    fflush(output);
+    return count;
+}
+
+LONG PutStr(CONST_STRPTR string) {
+    fputs(string, output);
+    fflush(output);
+    return 0;
+}
+
+// A microsecond E-clock
+ULONG ReadEClock(struct EClockVal *time) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    unsigned long long ticks = (unsigned long long)now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+    time->ev_hi = (ULONG)(ticks >> 32);
+    time->ev_lo = (ULONG)(ticks & 0xFFFFFFFFUL);
+    return 1000000;
+}
@@ -0,0 +1,110 @@
+#ifndef AMIGA_HOST_H
+#define AMIGA_HOST_H
+
+// The few exec, dos and timer.device calls the catalog code makes, on top
+// of the C library, so radiobench and gencatalog also run on the
+// development machine (see the "host" target in the Makefile). The
+// headers next to this one stand in for the NDK ones and include it.
+//
+// LONG and ULONG are the host's long, wide enough for the pointers the
+// code passes to VPrintf(). Records are therefore larger than on the
+// Amiga and host catalogs are not interchangeable with Amiga ones.
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int8_t BYTE;
+typedef uint8_t UBYTE;
+typedef int16_t WORD;
+typedef uint16_t UWORD;
+typedef long LONG;
+typedef unsigned long ULONG;
+typedef short BOOL;
+typedef void *APTR;
+typedef char *STRPTR;
+typedef const char *CONST_STRPTR;
+typedef long BPTR;
+
+#define TRUE 1
+#define FALSE 0
+
+// exec/memory.h. The attributes only matter for MEMF_CLEAR here.
+#define MEMF_ANY    0L
+#define MEMF_PUBLIC (1L << 0)
+#define MEMF_CHIP   (1L << 1)
+#define MEMF_FAST   (1L << 2)
+#define MEMF_CLEAR  (1L << 16)
+
+// dos/dos.h
+#define MODE_OLDFILE   1005
+#define MODE_NEWFILE   1006
+#define MODE_READWRITE 1004
+
+#define OFFSET_BEGINNING -1
+#define OFFSET_CURRENT   0
+#define OFFSET_END       1
+
+#define TICKS_PER_SECOND 50
+
+#define RETURN_OK    0
+#define RETURN_WARN  5
+#define RETURN_ERROR 10
+#define RETURN_FAIL  20
+
+struct DateStamp {
+    LONG ds_Days;
+    LONG ds_Minute;
+    LONG ds_Tick;
+};
+
+// devices/timer.h
+#define TIMERNAME "timer.device"
+#define UNIT_ECLOCK 2
+
+struct EClockVal {
+    ULONG ev_hi;
+    ULONG ev_lo;
+};
+
+struct Device {
+    const char *name;
+};
+
+struct IORequest {
+    struct Device *io_Device;
+};
+
+struct timerequest {
+    struct IORequest tr_node;
+};
+
+// Where radiobench sends the output of the stages
+#define NIL_FILE "/dev/null"
+
+// exec.library
+APTR AllocMem(ULONG size, ULONG requirements);
+void FreeMem(APTR memory, ULONG size);
+ULONG AvailMem(ULONG requirements);
+void CopyMem(const void *source, APTR dest, ULONG size);
+BYTE OpenDevice(CONST_STRPTR name, ULONG unit, struct IORequest *request, ULONG flags);
+void CloseDevice(struct IORequest *request);
+
+// dos.library. Names starting with PROGDIR: are taken from the current
+// directory.
+BPTR Open(CONST_STRPTR name, LONG mode);
+BOOL Close(BPTR file);
+LONG Read(BPTR file, APTR buffer, LONG length);
+LONG Write(BPTR file, const void *buffer, LONG length);
+LONG Seek(BPTR file, LONG position, LONG mode);
+BOOL DeleteFile(CONST_STRPTR name);
+BOOL Rename(CONST_STRPTR from, CONST_STRPTR to);
+struct DateStamp *DateStamp(struct DateStamp *date);
+
+// Output() is the standard output the program started with, so it still
+// reaches the console after stdout has been reopened
+LONG VPrintf(CONST_STRPTR format, const LONG *args);
+LONG PutStr(CONST_STRPTR string);
+
+// timer.device
+ULONG ReadEClock(struct EClockVal *time);
+
+#endif
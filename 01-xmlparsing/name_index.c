@@ -0,0 +1,145 @@
+#include <exec/types.h>
+#include <exec/memory.h>
+#include <proto/exec.h>
+#include <proto/dos.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+#include "radio.h"
+#include "radio_log.h"
+#include "radio_stats.h"
+
+ULONG fold_name(char *dst, const char *src) {
+    ULONG len;
+    for (len = 0; src[len] && len < MAX_NAME - 1; len++) {
+        dst[len] = tolower((unsigned char)src[len]);
+    }
+    dst[len] = '\0';
+    return len;
+}
+
+// Folded name order, ties by offset so the output does not depend on qsort
+static int compare_entries(const void *a, const void *b) {
+    const struct IndexEntry *x = a;
+    const struct IndexEntry *y = b;
+
+    for (ULONG i = 0; i < MAX_NAME; i++) {
+        int cx = tolower((unsigned char)x->server_name[i]);
+        int cy = tolower((unsigned char)y->server_name[i]);
+        if (cx != cy) return cx - cy;
+        if (cx == 0) break;
+    }
+    return x->offset < y->offset ? -1 : x->offset > y->offset;
+}
+
+void sort_index(struct IndexEntry *index, ULONG num_entries) {
+    qsort(index, num_entries, sizeof(struct IndexEntry), compare_entries);
+}
+
+BOOL save_sparse_index(const char *filename, struct IndexEntry *index, ULONG num_entries,
+                       const struct CatalogBuild *build) {
+    struct CatalogHeader header;
+    struct SparseEntry sparse;
+    char folded[MAX_NAME];
+    ULONG count = (num_entries + SPARSE_STEP - 1) / SPARSE_STEP;
+
+    log_info("Saving sparse index: %s (every %d entries)\n", filename, SPARSE_STEP);
+
+    BPTR file = radio_open(filename, MODE_NEWFILE);
+    if (!file) {
+        log_error("Failed to create sparse index file\n");
+        return FALSE;
+    }
+
+    // The checksum is known once the entries are written
+    catalog_header(&header, SPARSE_MAGIC, sizeof(struct SparseEntry), count, build);
+    if (radio_write(file, &header, sizeof(header)) != sizeof(header)) {
+        log_error("Failed to write sparse index file\n");
+        radio_close(file);
+        return FALSE;
+    }
+
+    for (ULONG i = 0; i < num_entries; i += SPARSE_STEP) {
+        memset(&sparse, 0, sizeof(sparse));
+        sparse.entry = i;
+        fold_name(folded, index[i].server_name);
+        // Truncated on purpose, the memset above terminates the key
+        ULONG length = strlen(folded);
+        memcpy(sparse.key, folded, length < SPARSE_KEY - 1 ? length : SPARSE_KEY - 1);
+        header.checksum = crc32(header.checksum, &sparse, sizeof(sparse));
+
+        if (radio_write(file, &sparse, sizeof(sparse)) != sizeof(sparse)) {
+            log_error("Failed to write sparse index file\n");
+            radio_close(file);
+            return FALSE;
+        }
+    }
+
+    if (radio_seek(file, 0, OFFSET_BEGINNING) == -1 ||
+        radio_write(file, &header, sizeof(header)) != sizeof(header)) {
+        log_error("Failed to write sparse index header\n");
+        radio_close(file);
+        return FALSE;
+    }
+
+    radio_close(file);
+    return TRUE;
+}
+
+// First index entry to read for prefix: the last sparse key that sorts
+// before it. Keys are truncated, so equal keys count as "not before" and
+// the scan starts a block early rather than too late. A radio.spx that
+// does not belong to the index is ignored.
+ULONG find_prefix_start(const char *spx_filename, const struct CatalogHeader *index_header,
+                        const char *prefix, BOOL *sorted) {
+    struct CatalogHeader header;
+
+    *sorted = FALSE;
+
+    BPTR file = radio_open(spx_filename, MODE_OLDFILE);
+    if (!file) return 0;
+
+    if (!read_catalog_header(file, spx_filename, SPARSE_MAGIC, sizeof(struct SparseEntry), &header)) {
+        radio_close(file);
+        return 0;
+    }
+
+    ULONG count = header.num_entries;
+    ULONG size = sizeof(struct SparseEntry) * count;
+    if (header.build_stamp != index_header->build_stamp ||
+        header.data_checksum != index_header->data_checksum ||
+        count != (index_header->num_entries + SPARSE_STEP - 1) / SPARSE_STEP) {
+        log_error("%s does not belong to this index, ignoring it\n", spx_filename);
+        radio_close(file);
+        return 0;
+    }
+
+    struct SparseEntry *sparse = count ? radio_alloc(size, MEMF_ANY) : NULL;
+    if (!sparse || radio_read(file, sparse, size) != (LONG)size ||
+        crc32(0, sparse, size) != header.checksum) {
+        log_error("%s is damaged, ignoring it\n", spx_filename);
+        if (sparse) radio_free(sparse, size);
+        radio_close(file);
+        return 0;
+    }
+    radio_close(file);
+
+    ULONG low = 0;
+    ULONG high = count;
+    while (low < high) {
+        ULONG mid = (low + high) / 2;
+        if (strncmp(sparse[mid].key, prefix, SPARSE_KEY - 1) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    ULONG start = low > 0 ? sparse[low - 1].entry : 0;
+    radio_free(sparse, size);
+
+    *sorted = start < index_header->num_entries;
+    return *sorted ? start : 0;
+}
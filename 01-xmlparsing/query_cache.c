@@ -0,0 +1,291 @@
+#include <exec/types.h>
+#include <exec/memory.h>
+#include <proto/exec.h>
+#include <proto/dos.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "radio.h"
+#include "radio_log.h"
+#include "radio_stats.h"
+
+#define MATCH_GROW 64
+#define COMPACT_MIN_BYTES 16384
+#define MAX_FILENAME 108
+
+// radio.qc: a CacheDirectory, then the entry lists it points at. Lists of
+// evicted queries stay in the file as dead bytes until a compaction.
+struct CacheSlot {
+    char key[CACHE_KEY];
+    ULONG last_used;
+    ULONG offset;
+    ULONG count;
+    ULONG checksum;
+} ALIGN;
+
+struct CacheDirectory {
+    struct CatalogHeader catalog;
+    ULONG clock;
+    ULONG dead_bytes;
+    struct CacheSlot slot[CACHE_SLOTS];
+} ALIGN;
+
+static struct {
+    char filename[MAX_FILENAME];
+    struct CacheDirectory dir;
+    BOOL open;
+    BOOL exists;
+    BOOL dirty;
+} cache;
+
+BOOL match_add(struct MatchList *list, ULONG entry) {
+    if (!list || list->overflow) return FALSE;
+
+    if (list->count == list->capacity) {
+        ULONG capacity = list->capacity + (list->capacity ? list->capacity : MATCH_GROW);
+        ULONG *entries = capacity <= CACHE_MAX_MATCHES ?
+            radio_alloc(sizeof(ULONG) * capacity, MEMF_ANY) : NULL;
+
+        // Too many to be worth caching, keep searching without a list
+        if (!entries) {
+            match_free(list);
+            list->overflow = TRUE;
+            return FALSE;
+        }
+        if (list->entries) {
+            memcpy(entries, list->entries, sizeof(ULONG) * list->count);
+            radio_free(list->entries, sizeof(ULONG) * list->capacity);
+        }
+        list->entries = entries;
+        list->capacity = capacity;
+    }
+
+    list->entries[list->count++] = entry;
+    return TRUE;
+}
+
+void match_free(struct MatchList *list) {
+    if (list->entries) radio_free(list->entries, sizeof(ULONG) * list->capacity);
+    list->entries = NULL;
+    list->count = 0;
+    list->capacity = 0;
+    list->cached = FALSE;
+}
+
+void trim_term(char *dst, ULONG size, const char *term) {
+    while (*term == ' ' || *term == '\t') term++;
+    ULONG length = strlen(term);
+    while (length > 0 && (term[length - 1] == ' ' || term[length - 1] == '\t')) length--;
+    if (length > size - 1) length = size - 1;
+
+    memcpy(dst, term, length);
+    dst[length] = '\0';
+}
+
+// Genre matches are case sensitive, so the trimmed term is the key as it
+// is; a bitrate is stored as the number search_by_bitrate will compare with
+void cache_key(char *key, const char *type, const char *term) {
+    if (strcmp(type, "-b") == 0) {
+        snprintf(key, CACHE_KEY, "b %u", (UWORD)atoi(term));
+        return;
+    }
+
+    snprintf(key, CACHE_KEY, "%c %.*s", type[1], CACHE_KEY - 4, term);
+}
+
+void cache_open(const char *filename, const struct CatalogHeader *catalog) {
+    memset(&cache, 0, sizeof(cache));
+    strncpy(cache.filename, filename, MAX_FILENAME - 1);
+    cache.open = TRUE;
+
+    BPTR file = radio_open(filename, MODE_OLDFILE);
+    if (file) {
+        LONG length = radio_read(file, &cache.dir, sizeof(cache.dir));
+        radio_close(file);
+        cache.exists = TRUE;
+
+        // A cache for an older catalog is thrown away on the next store
+        if (length == sizeof(cache.dir) && cache.dir.catalog.magic == CACHE_MAGIC &&
+            cache.dir.catalog.version == CATALOG_VERSION &&
+            cache.dir.catalog.record_size == sizeof(ULONG) &&
+            catalog_matches(&cache.dir.catalog, catalog)) {
+            return;
+        }
+        log_trace("Discarding stale query cache %s\n", filename);
+    }
+
+    struct CatalogBuild build = {catalog->build_stamp, catalog->data_checksum};
+    memset(&cache.dir, 0, sizeof(cache.dir));
+    catalog_header(&cache.dir.catalog, CACHE_MAGIC, sizeof(ULONG), catalog->num_entries, &build);
+    cache.exists = FALSE;
+}
+
+static struct CacheSlot *find_slot(const char *key) {
+    for (UWORD i = 0; i < CACHE_SLOTS; i++) {
+        struct CacheSlot *slot = &cache.dir.slot[i];
+        if (slot->last_used && strcmp(slot->key, key) == 0) return slot;
+    }
+    return NULL;
+}
+
+BOOL cache_lookup(const char *key, struct MatchList *list) {
+    if (!cache.open || !cache.exists) return FALSE;
+
+    struct CacheSlot *slot = find_slot(key);
+    if (!slot) return FALSE;
+
+    ULONG size = sizeof(ULONG) * slot->count;
+    list->entries = size ? radio_alloc(size, MEMF_ANY) : NULL;
+    list->capacity = slot->count;
+    list->count = 0;
+
+    BPTR file = radio_open(cache.filename, MODE_OLDFILE);
+    LONG length = -1;
+    if (file && (size == 0 || list->entries) &&
+        radio_seek(file, slot->offset, OFFSET_BEGINNING) != -1) {
+        length = size ? radio_read(file, list->entries, size) : 0;
+    }
+    if (file) radio_close(file);
+
+    if (length != (LONG)size || crc32(0, list->entries, size) != slot->checksum) {
+        log_error("Query cache entry for \"%s\" is damaged, searching again\n", key + 2);
+        match_free(list);
+        slot->last_used = 0;
+        cache.dirty = TRUE;
+        return FALSE;
+    }
+
+    // A query that is already the most recent one needs no directory write
+    if (slot->last_used != cache.dir.clock) {
+        slot->last_used = ++cache.dir.clock;
+        cache.dirty = TRUE;
+    }
+
+    list->count = slot->count;
+    list->cached = TRUE;
+    log_trace("Query cache hit for \"%s\": %lu entries\n", key + 2, slot->count);
+    return TRUE;
+}
+
+static BOOL write_directory(BPTR file) {
+    return radio_seek(file, 0, OFFSET_BEGINNING) != -1 &&
+           radio_write(file, &cache.dir, sizeof(cache.dir)) == sizeof(cache.dir);
+}
+
+// Copies the live lists to a new file, which then replaces the cache
+static BOOL compact(void) {
+    char temp[MAX_FILENAME + 4];
+    BOOL success = FALSE;
+
+    snprintf(temp, sizeof(temp), "%s.new", cache.filename);
+
+    BPTR in = radio_open(cache.filename, MODE_OLDFILE);
+    BPTR out = radio_open(temp, MODE_NEWFILE);
+    if (!in || !out || !write_directory(out)) goto done;
+
+    ULONG position = sizeof(cache.dir);
+    for (UWORD i = 0; i < CACHE_SLOTS; i++) {
+        struct CacheSlot *slot = &cache.dir.slot[i];
+        ULONG size = sizeof(ULONG) * slot->count;
+        if (!slot->last_used || size == 0) continue;
+
+        APTR buffer = radio_alloc(size, MEMF_ANY);
+        BOOL copied = buffer && radio_seek(in, slot->offset, OFFSET_BEGINNING) != -1 &&
+                      radio_read(in, buffer, size) == (LONG)size &&
+                      radio_write(out, buffer, size) == (LONG)size;
+        if (buffer) radio_free(buffer, size);
+        if (!copied) goto done;
+
+        slot->offset = position;
+        position += size;
+    }
+
+    cache.dir.dead_bytes = 0;
+    success = write_directory(out);
+
+done:
+    if (in) radio_close(in);
+    if (out) radio_close(out);
+    if (success) {
+        DeleteFile((CONST_STRPTR)cache.filename);
+        success = Rename((CONST_STRPTR)temp, (CONST_STRPTR)cache.filename);
+    } else {
+        DeleteFile((CONST_STRPTR)temp);
+    }
+    return success;
+}
+
+void cache_store(const char *key, const struct MatchList *list) {
+    if (!cache.open || list->overflow || list->cached) return;
+
+    // Reuse the slot of the same query, else an empty or the least recent one
+    struct CacheSlot *slot = find_slot(key);
+    if (!slot) {
+        slot = &cache.dir.slot[0];
+        for (UWORD i = 1; i < CACHE_SLOTS && slot->last_used; i++) {
+            if (cache.dir.slot[i].last_used < slot->last_used) slot = &cache.dir.slot[i];
+        }
+    }
+
+    if (slot->last_used) {
+        cache.dir.dead_bytes += sizeof(ULONG) * slot->count;
+        slot->last_used = 0;
+    }
+
+    ULONG live_bytes = 0;
+    for (UWORD i = 0; i < CACHE_SLOTS; i++) {
+        if (cache.dir.slot[i].last_used) live_bytes += sizeof(ULONG) * cache.dir.slot[i].count;
+    }
+    if (cache.exists && cache.dir.dead_bytes > COMPACT_MIN_BYTES &&
+        cache.dir.dead_bytes > live_bytes && !compact()) {
+        cache.exists = FALSE;
+    }
+
+    BPTR file;
+    if (cache.exists) {
+        file = radio_open(cache.filename, MODE_READWRITE);
+    } else {
+        // Start over, dropping any stale lists
+        memset(cache.dir.slot, 0, sizeof(cache.dir.slot));
+        cache.dir.clock = 0;
+        cache.dir.dead_bytes = 0;
+        file = radio_open(cache.filename, MODE_NEWFILE);
+        if (file && !write_directory(file)) {
+            radio_close(file);
+            file = 0;
+        }
+    }
+    if (!file) {
+        log_trace("Cannot write query cache %s\n", cache.filename);
+        return;
+    }
+
+    ULONG size = sizeof(ULONG) * list->count;
+    radio_seek(file, 0, OFFSET_END);
+    LONG position = radio_seek(file, 0, OFFSET_CURRENT);
+
+    if (position >= (LONG)sizeof(cache.dir) &&
+        (size == 0 || radio_write(file, list->entries, size) == (LONG)size)) {
+        strncpy(slot->key, key, CACHE_KEY - 1);
+        slot->offset = position;
+        slot->count = list->count;
+        slot->checksum = crc32(0, list->entries, size);
+        slot->last_used = ++cache.dir.clock;
+    }
+
+    cache.exists = write_directory(file);
+    cache.dirty = FALSE;
+    radio_close(file);
+}
+
+void cache_close(void) {
+    if (cache.open && cache.dirty && cache.exists) {
+        BPTR file = radio_open(cache.filename, MODE_READWRITE);
+        if (file) {
+            write_directory(file);
+            radio_close(file);
+        }
+    }
+    memset(&cache, 0, sizeof(cache));
+}
@@ -0,0 +1,160 @@
+#ifndef RADIO_H
+#define RADIO_H
+
+#include <exec/types.h>
+#include <dos/dos.h>
+
+#define ALIGN __attribute__((aligned(2)))
+
+struct RadioEntry {
+    char server_name[64];
+    char server_type[16];
+    UWORD bitrate;
+    UWORD pad1;
+    ULONG samplerate;
+    UBYTE channels;
+    UBYTE pad2[3];
+    char listen_url[128];
+    char current_song[128];
+    char genre[32];
+} ALIGN;
+
+struct IndexEntry {
+    ULONG offset;
+    char server_name[64];
+} ALIGN;
+
+// A sorted radio.idx comes with radio.spx: the folded name of every
+// SPARSE_STEP-th index entry, truncated to SPARSE_KEY - 1 characters
+#define SPARSE_STEP 64
+#define SPARSE_KEY 28
+
+struct SparseEntry {
+    ULONG entry;
+    char key[SPARSE_KEY];
+} ALIGN;
+
+// radio.bin, radio.idx and radio.spx all start with a CatalogHeader.
+// build_stamp and data_checksum (CRC32 of the uncompressed radio.bin
+// records) are the same in all files written by one radioparser run;
+// checksum covers everything after the header of that one file.
+#define CATALOG_VERSION 1
+#define DATA_MAGIC   0x5242494EUL  // "RBIN"
+#define BLOCK_MAGIC  0x52424C4BUL  // "RBLK"
+#define INDEX_MAGIC  0x52494458UL  // "RIDX"
+#define SPARSE_MAGIC 0x52535058UL  // "RSPX"
+
+struct CatalogHeader {
+    ULONG magic;
+    UWORD version;
+    UWORD record_size;
+    ULONG num_entries;
+    ULONG build_stamp;
+    ULONG data_checksum;
+    ULONG checksum;
+} ALIGN;
+
+struct CatalogBuild {
+    ULONG stamp;
+    ULONG data_checksum;
+};
+
+// radioparser --compress writes radio.bin as BLOCK_MAGIC header, the
+// records in BLOCK_ENTRIES-entry blocks each compressed with lz_compress,
+// then the file offsets of the blocks plus one for the end of the last.
+// Index offsets stay those of the uncompressed records.
+#define BLOCK_ENTRIES 64
+
+// Entry numbers matched by a genre or bitrate search, for the query cache
+struct MatchList {
+    ULONG *entries;
+    ULONG count;
+    ULONG capacity;
+    BOOL cached;    // read from the cache: replay instead of scanning
+    BOOL overflow;  // more than CACHE_MAX_MATCHES, not kept
+};
+
+// xml_parser.c
+// Upper bound for the entry tables: the number of <entry> tags in filename
+ULONG count_entries(const char *filename, ULONG *file_size);
+BOOL process_xml(BPTR file, struct RadioEntry *entries, struct IndexEntry *index,
+                 ULONG max_entries, ULONG *num_entries);
+BOOL save_binary_format(const char *filename, struct RadioEntry *entries, ULONG num_entries,
+                        const struct CatalogBuild *build);
+BOOL save_index(const char *filename, struct IndexEntry *index, ULONG num_entries,
+                const struct CatalogBuild *build);
+
+// radio_search.c
+void load_index(const unsigned char *filename, struct IndexEntry **index, ULONG *num_entries,
+                struct CatalogHeader *header);
+struct RadioEntry *load_entry(const unsigned char *filename, ULONG offset);
+void print_entry(struct RadioEntry *entry);
+void search_by_name(const char *term, const char *bin_filename,
+                    struct IndexEntry *index, ULONG num_entries);
+void search_by_genre(const char *genre, const char *bin_filename,
+                    struct IndexEntry *index, ULONG num_entries, struct MatchList *matches);
+void search_by_bitrate(UWORD min_bitrate, const char *bin_filename,
+                      struct IndexEntry *index, ULONG num_entries, struct MatchList *matches);
+void search_by_prefix(const char *prefix, const char *idx_filename, const char *spx_filename,
+                      const char *bin_filename, ULONG limit);
+// The station named name, ignoring case, or NULL. The entry is only valid
+// until the next load_entry.
+struct RadioEntry *find_station(const char *name, const char *idx_filename,
+                                const char *spx_filename, const char *bin_filename);
+
+// ranked_search.c
+#define RANKED_TOP_K 10
+
+// Exact and prefix matches come from the run radio.spx points to when the
+// index is sorted, the rest of the index is only scored if they do not
+// fill top_k
+void search_ranked(const char *term, const char *bin_filename, const char *spx_filename,
+                   const struct CatalogHeader *index_header,
+                   struct IndexEntry *index, ULONG num_entries, ULONG top_k);
+
+// name_index.c
+#define MAX_NAME 64
+
+ULONG fold_name(char *dst, const char *src);
+void sort_index(struct IndexEntry *index, ULONG num_entries);
+BOOL save_sparse_index(const char *filename, struct IndexEntry *index, ULONG num_entries,
+                       const struct CatalogBuild *build);
+ULONG find_prefix_start(const char *spx_filename, const struct CatalogHeader *index_header,
+                        const char *prefix, BOOL *sorted);
+
+// block_file.c
+BOOL save_blocked_format(const char *filename, struct RadioEntry *entries, ULONG num_entries,
+                         const struct CatalogBuild *build);
+BOOL is_blocked_file(const char *filename);
+struct RadioEntry *load_block_entry(const char *filename, ULONG entry);
+void block_file_close(void);
+
+// catalog.c
+ULONG crc32(ULONG crc, const void *data, ULONG length);
+void catalog_build(struct CatalogBuild *build, struct RadioEntry *entries, ULONG num_entries);
+void catalog_header(struct CatalogHeader *header, ULONG magic, UWORD record_size,
+                    ULONG num_entries, const struct CatalogBuild *build);
+BOOL read_catalog_header(BPTR file, const char *filename, ULONG magic, UWORD record_size,
+                         struct CatalogHeader *header);
+BOOL check_catalog_size(BPTR file, const char *filename, const struct CatalogHeader *header);
+BOOL catalog_matches(const struct CatalogHeader *a, const struct CatalogHeader *b);
+BOOL check_data_file(const char *filename, const struct CatalogHeader *index_header, BOOL verify);
+
+// query_cache.c
+#define CACHE_MAGIC 0x52514348UL  // "RQCH"
+#define CACHE_SLOTS 16
+#define CACHE_KEY 40
+#define CACHE_MAX_MATCHES 8192
+
+BOOL match_add(struct MatchList *list, ULONG entry);
+void match_free(struct MatchList *list);
+// Copies term without surrounding blanks, the form both the search and
+// cache_key() have to be given
+void trim_term(char *dst, ULONG size, const char *term);
+void cache_key(char *key, const char *type, const char *term);
+void cache_open(const char *filename, const struct CatalogHeader *catalog);
+BOOL cache_lookup(const char *key, struct MatchList *list);
+void cache_store(const char *key, const struct MatchList *list);
+void cache_close(void);
+
+#endif
@@ -0,0 +1,285 @@
+#include <exec/types.h>
+#include <exec/memory.h>
+#include <devices/timer.h>
+#include <proto/exec.h>
+#include <proto/dos.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "radio.h"
+#include "radio_stats.h"
+
+// Times every stage of radioparser and radiosearch on one XML directory,
+// e.g. one written by gencatalog. The catalog is written to radio.bin and
+// radio.idx in the current directory, the index sorted by name as with
+// radioparser --sorted. The scans run again on radiolz.bin, the same
+// entries written as with radioparser --compress, to compare block
+// decompression against reading the raw records. The genre search runs
+// once more to fill a fresh radio.qc and once to replay it from there.
+// Everything the stages print goes to NIL: so console output does not
+// distort the timings.
+
+#define BIN_FILE "radio.bin"
+#define IDX_FILE "radio.idx"
+#define SPX_FILE "radio.spx"
+#define PACK_FILE "radiolz.bin"
+#define CACHE_FILE "radio.qc"
+
+#ifndef NIL_FILE
+#define NIL_FILE "NIL:"
+#endif
+
+static ULONG mem_baseline;
+static ULONG mem_low;
+
+static const char *REPORT_HEADER = "Phase                   Time ms   Entries/s     Bytes/s    Held KB\n";
+static const char *REPORT_LINE = "%-22s %8ld %11ld %11ld %10ld\n";
+static const char *REPORT_SIZE = "Binary file: %ld KB raw, %ld KB compressed\n";
+static const char *REPORT_PEAK = "Peak memory in use: %ld KB for %ld entries\n";
+
+static ULONG elapsed_micros(const struct EClockVal *start) {
+    struct EClockVal now;
+    timer_now(&now);
+    return timer_micros(start, &now);
+}
+
+// Memory held since the benchmark started, tracking the low water mark
+static ULONG memory_held(void) {
+    ULONG avail = AvailMem(MEMF_ANY);
+    if (avail < mem_low) mem_low = avail;
+    return mem_baseline > avail ? mem_baseline - avail : 0;
+}
+
+static void report(const char *phase, ULONG micros, ULONG entries, ULONG bytes) {
+    ULONG held = memory_held();
+    ULONG rate = micros ? (ULONG)((unsigned long long)entries * 1000000ULL / micros) : 0;
+    ULONG byte_rate = micros ? (ULONG)((unsigned long long)bytes * 1000000ULL / micros) : 0;
+
+    LONG args[] = {(LONG)phase, (LONG)(micros / 1000), (LONG)rate, (LONG)byte_rate,
+                   (LONG)(held / 1024)};
+    VPrintf((STRPTR)REPORT_LINE, (LONG *)args);
+}
+
+static ULONG file_length(const char *filename) {
+    BPTR file = Open((CONST_STRPTR)filename, MODE_OLDFILE);
+    if (!file) return 0;
+
+    Seek(file, 0, OFFSET_END);
+    LONG size = Seek(file, 0, OFFSET_BEGINNING);
+    Close(file);
+    return size > 0 ? (ULONG)size : 0;
+}
+
+int main(int argc, char **argv) {
+    const char *name_term = "radio";
+    const char *genre_term = "jazz";
+    UWORD min_bitrate = 192;
+    struct EClockVal start;
+    ULONG micros;
+    ULONG file_size;
+
+    if (argc != 2 && argc != 5) {
+        printf("Usage: %s <xml_file> [<name> <genre> <min_bitrate>]\n", argv[0]);
+        printf("Writes %s, %s, %s, %s and %s to the current directory\n",
+               BIN_FILE, PACK_FILE, IDX_FILE, SPX_FILE, CACHE_FILE);
+        return 1;
+    }
+    if (argc == 5) {
+        name_term = argv[2];
+        genre_term = argv[3];
+        min_bitrate = (UWORD)atoi(argv[4]);
+    }
+
+    ULONG capacity = count_entries(argv[1], &file_size);
+    if (capacity == 0) {
+        printf("No entries in %s\n", argv[1]);
+        return 3;
+    }
+
+    if (!timer_open()) {
+        printf("Could not open %s\n", TIMERNAME);
+        return 2;
+    }
+
+    // Silence the stages, the report goes straight to Output()
+    if (!freopen(NIL_FILE, "w", stdout)) {
+        timer_close();
+        return 2;
+    }
+
+    mem_baseline = mem_low = AvailMem(MEMF_ANY);
+    VPrintf((STRPTR)REPORT_HEADER, NULL);
+
+    ULONG entries_size = sizeof(struct RadioEntry) * capacity;
+    ULONG index_size = sizeof(struct IndexEntry) * capacity;
+    struct RadioEntry *entries = AllocMem(entries_size, MEMF_CLEAR);
+    struct IndexEntry *index = AllocMem(index_size, MEMF_CLEAR);
+    int rc = 0;
+
+    BPTR file = Open((CONST_STRPTR)argv[1], MODE_OLDFILE);
+    if (!entries || !index || !file) {
+        PutStr("Not enough memory or unable to open input\n");
+        if (file) Close(file);
+        rc = 2;
+        goto done;
+    }
+
+    ULONG num_entries;
+    timer_now(&start);
+    BOOL parsed = process_xml(file, entries, index, capacity, &num_entries);
+    micros = elapsed_micros(&start);
+    report("process_xml", micros, num_entries, file_size);
+    Close(file);
+
+    if (!parsed) {
+        rc = 3;
+        goto done;
+    }
+
+    struct CatalogBuild build;
+    timer_now(&start);
+    catalog_build(&build, entries, num_entries);
+    micros = elapsed_micros(&start);
+    report("catalog_build", micros, num_entries, sizeof(struct RadioEntry) * num_entries);
+
+    timer_now(&start);
+    save_binary_format(BIN_FILE, entries, num_entries, &build);
+    micros = elapsed_micros(&start);
+    report("save_binary_format", micros, num_entries, sizeof(struct RadioEntry) * num_entries);
+
+    timer_now(&start);
+    save_blocked_format(PACK_FILE, entries, num_entries, &build);
+    micros = elapsed_micros(&start);
+    report("save_blocked_format", micros, num_entries, sizeof(struct RadioEntry) * num_entries);
+
+    timer_now(&start);
+    sort_index(index, num_entries);
+    micros = elapsed_micros(&start);
+    report("sort_index", micros, num_entries, sizeof(struct IndexEntry) * num_entries);
+
+    timer_now(&start);
+    save_index(IDX_FILE, index, num_entries, &build);
+    micros = elapsed_micros(&start);
+    report("save_index", micros, num_entries, sizeof(struct IndexEntry) * num_entries);
+
+    timer_now(&start);
+    save_sparse_index(SPX_FILE, index, num_entries, &build);
+    micros = elapsed_micros(&start);
+    report("save_sparse_index", micros, num_entries,
+           sizeof(struct SparseEntry) * ((num_entries + SPARSE_STEP - 1) / SPARSE_STEP));
+
+    // Searching only needs the index, as in radiosearch
+    FreeMem(entries, entries_size);
+    FreeMem(index, index_size);
+    entries = NULL;
+    index = NULL;
+
+    // Prefix search reads only the part of radio.idx it needs, so its rate
+    // is in matches rather than in catalog entries
+    ULONG matched = radio_stats.entries_matched;
+    timer_now(&start);
+    search_by_prefix(name_term, IDX_FILE, SPX_FILE, BIN_FILE, RANKED_TOP_K);
+    micros = elapsed_micros(&start);
+    report("search_by_prefix", micros, radio_stats.entries_matched - matched, 0);
+
+    struct IndexEntry *loaded = NULL;
+    ULONG loaded_entries = 0;
+    struct CatalogHeader header;
+
+    timer_now(&start);
+    load_index((const unsigned char *)IDX_FILE, &loaded, &loaded_entries, &header);
+    micros = elapsed_micros(&start);
+    report("load_index", micros, loaded_entries, sizeof(struct IndexEntry) * loaded_entries);
+
+    if (loaded) {
+        // Full checksum pass, radiosearch --verify
+        timer_now(&start);
+        check_data_file(BIN_FILE, &header, TRUE);
+        micros = elapsed_micros(&start);
+        report("check_data_file", micros, loaded_entries,
+               sizeof(struct RadioEntry) * loaded_entries);
+
+        timer_now(&start);
+        search_by_name(name_term, BIN_FILE, loaded, loaded_entries);
+        micros = elapsed_micros(&start);
+        report("search_by_name", micros, loaded_entries,
+               sizeof(struct IndexEntry) * loaded_entries);
+
+        timer_now(&start);
+        search_ranked(name_term, BIN_FILE, SPX_FILE, &header, loaded, loaded_entries, RANKED_TOP_K);
+        micros = elapsed_micros(&start);
+        report("search_ranked", micros, loaded_entries,
+               sizeof(struct IndexEntry) * loaded_entries);
+
+        timer_now(&start);
+        search_by_genre(genre_term, BIN_FILE, loaded, loaded_entries, NULL);
+        micros = elapsed_micros(&start);
+        report("search_by_genre", micros, loaded_entries,
+               sizeof(struct RadioEntry) * loaded_entries);
+
+        struct MatchList matches = {0};
+        char key[CACHE_KEY];
+
+        cache_key(key, "-g", genre_term);
+        DeleteFile((CONST_STRPTR)CACHE_FILE);
+        cache_open(CACHE_FILE, &header);
+
+        timer_now(&start);
+        search_by_genre(genre_term, BIN_FILE, loaded, loaded_entries, &matches);
+        cache_store(key, &matches);
+        micros = elapsed_micros(&start);
+        report("search_by_genre store", micros, loaded_entries,
+               sizeof(struct RadioEntry) * loaded_entries);
+        match_free(&matches);
+
+        timer_now(&start);
+        cache_lookup(key, &matches);
+        search_by_genre(genre_term, BIN_FILE, loaded, loaded_entries, &matches);
+        micros = elapsed_micros(&start);
+        report("search_by_genre cached", micros, matches.count, sizeof(ULONG) * matches.count);
+        match_free(&matches);
+        cache_close();
+
+        timer_now(&start);
+        search_by_bitrate(min_bitrate, BIN_FILE, loaded, loaded_entries, NULL);
+        micros = elapsed_micros(&start);
+        report("search_by_bitrate", micros, loaded_entries,
+               sizeof(struct RadioEntry) * loaded_entries);
+
+        // Bytes/s counts uncompressed records, as above
+        timer_now(&start);
+        search_by_name(name_term, PACK_FILE, loaded, loaded_entries);
+        micros = elapsed_micros(&start);
+        report("search_by_name lz", micros, loaded_entries,
+               sizeof(struct IndexEntry) * loaded_entries);
+
+        timer_now(&start);
+        search_by_genre(genre_term, PACK_FILE, loaded, loaded_entries, NULL);
+        micros = elapsed_micros(&start);
+        report("search_by_genre lz", micros, loaded_entries,
+               sizeof(struct RadioEntry) * loaded_entries);
+
+        timer_now(&start);
+        search_by_bitrate(min_bitrate, PACK_FILE, loaded, loaded_entries, NULL);
+        micros = elapsed_micros(&start);
+        report("search_by_bitrate lz", micros, loaded_entries,
+               sizeof(struct RadioEntry) * loaded_entries);
+
+        block_file_close();
+
+        FreeMem(loaded, sizeof(struct IndexEntry) * loaded_entries);
+    }
+
+    LONG sizes[] = {(LONG)(file_length(BIN_FILE) / 1024), (LONG)(file_length(PACK_FILE) / 1024)};
+    VPrintf((STRPTR)REPORT_SIZE, (LONG *)sizes);
+
+    LONG args[] = {(LONG)((mem_baseline - mem_low) / 1024), (LONG)num_entries};
+    VPrintf((STRPTR)REPORT_PEAK, (LONG *)args);
+
+done:
+    if (entries) FreeMem(entries, entries_size);
+    if (index) FreeMem(index, index_size);
+    timer_close();
+    return rc;
+}
@@ -0,0 +1,23 @@
+#ifndef RADIO_LOG_H
+#define RADIO_LOG_H
+
+#include <stdio.h>
+
+// Message levels, selected at run time with --quiet and --verbose
+#define LOG_ERROR 0
+#define LOG_INFO  1
+#define LOG_TRACE 2
+
+extern int log_level;
+
+#define log_error(...) printf(__VA_ARGS__)
+#define log_info(...) do { if (log_level >= LOG_INFO) printf(__VA_ARGS__); } while (0)
+
+// Per block and per field traces only exist in debug builds
+#ifdef DEBUG_BUILD
+#define log_trace(...) do { if (log_level >= LOG_TRACE) printf(__VA_ARGS__); } while (0)
+#else
+#define log_trace(...) do { } while (0)
+#endif
+
+#endif
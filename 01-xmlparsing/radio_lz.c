@@ -0,0 +1,130 @@
+#include <exec/types.h>
+#include <string.h>
+
+#include "radio_lz.h"
+
+#define MIN_MATCH 4
+#define MAX_OFFSET 65535
+#define RUN_MASK 15
+
+#define HASH_BITS 12
+#define HASH_SIZE (1 << HASH_BITS)
+
+// Position + 1 of the last place each hash was seen, 0 for never
+static UWORD last_seen[HASH_SIZE];
+
+static ULONG hash4(const UBYTE *p) {
+    ULONG v = ((ULONG)p[0] << 24) | ((ULONG)p[1] << 16) | ((ULONG)p[2] << 8) | p[3];
+    return (v * 2654435761UL) >> (32 - HASH_BITS) & (HASH_SIZE - 1);
+}
+
+// Lengths from 15 up continue in extra bytes, 255 meaning "more follows"
+static UBYTE *put_length(UBYTE *out, ULONG length) {
+    for (; length >= 255; length -= 255) *out++ = 255;
+    *out++ = (UBYTE)length;
+    return out;
+}
+
+static UBYTE *put_sequence(UBYTE *out, const UBYTE *literals, ULONG literal_length,
+                           ULONG offset, ULONG match_length) {
+    UBYTE *token = out++;
+    ULONG match_code = match_length ? match_length - MIN_MATCH : 0;
+
+    *token = (literal_length < RUN_MASK ? literal_length : RUN_MASK) << 4;
+    if (literal_length >= RUN_MASK) out = put_length(out, literal_length - RUN_MASK);
+    memcpy(out, literals, literal_length);
+    out += literal_length;
+
+    // The last sequence carries literals only
+    if (match_length == 0) return out;
+
+    *out++ = (UBYTE)offset;
+    *out++ = (UBYTE)(offset >> 8);
+    *token |= match_code < RUN_MASK ? match_code : RUN_MASK;
+    if (match_code >= RUN_MASK) out = put_length(out, match_code - RUN_MASK);
+    return out;
+}
+
+ULONG lz_compress(const UBYTE *src, ULONG length, UBYTE *dst) {
+    ULONG pos = 0;
+    ULONG anchor = 0;
+    UBYTE *out = dst;
+
+    // Positions past this no longer fit last_seen
+    if (length > LZ_MAX_INPUT) return 0;
+
+    memset(last_seen, 0, sizeof(last_seen));
+
+    while (length >= MIN_MATCH && pos <= length - MIN_MATCH) {
+        ULONG h = hash4(src + pos);
+        ULONG candidate = last_seen[h];
+        last_seen[h] = (UWORD)(pos + 1);
+
+        if (candidate == 0 || pos + 1 - candidate > MAX_OFFSET ||
+            memcmp(src + candidate - 1, src + pos, MIN_MATCH) != 0) {
+            pos++;
+            continue;
+        }
+
+        ULONG match = candidate - 1;
+        ULONG match_length = MIN_MATCH;
+        while (pos + match_length < length && src[match + match_length] == src[pos + match_length]) {
+            match_length++;
+        }
+
+        out = put_sequence(out, src + anchor, pos - anchor, pos - match, match_length);
+        pos += match_length;
+        anchor = pos;
+    }
+
+    out = put_sequence(out, src + anchor, length - anchor, 0, 0);
+    return (ULONG)(out - dst);
+}
+
+static BOOL get_length(const UBYTE **in, const UBYTE *end, ULONG *length) {
+    UBYTE b;
+    do {
+        if (*in >= end) return FALSE;
+        b = *(*in)++;
+        *length += b;
+    } while (b == 255);
+    return TRUE;
+}
+
+BOOL lz_decompress(const UBYTE *src, ULONG src_length, UBYTE *dst, ULONG length) {
+    const UBYTE *in = src;
+    const UBYTE *in_end = src + src_length;
+    UBYTE *out = dst;
+    UBYTE *out_end = dst + length;
+
+    while (in < in_end) {
+        UBYTE token = *in++;
+
+        ULONG literal_length = token >> 4;
+        if (literal_length == RUN_MASK && !get_length(&in, in_end, &literal_length)) return FALSE;
+        if (literal_length > (ULONG)(in_end - in) || literal_length > (ULONG)(out_end - out)) {
+            return FALSE;
+        }
+        memcpy(out, in, literal_length);
+        in += literal_length;
+        out += literal_length;
+
+        if (in == in_end) break;
+
+        if (in_end - in < 2) return FALSE;
+        ULONG offset = in[0] | ((ULONG)in[1] << 8);
+        in += 2;
+        if (offset == 0 || offset > (ULONG)(out - dst)) return FALSE;
+
+        ULONG match_length = token & RUN_MASK;
+        if (match_length == RUN_MASK && !get_length(&in, in_end, &match_length)) return FALSE;
+        match_length += MIN_MATCH;
+        if (match_length > (ULONG)(out_end - out)) return FALSE;
+
+        // Byte by byte, the match may overlap what it is copying
+        const UBYTE *match = out - offset;
+        while (match_length--) *out++ = *match++;
+    }
+
+    return out == out_end;
+}
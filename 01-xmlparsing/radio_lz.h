@@ -0,0 +1,23 @@
+#ifndef RADIO_LZ_H
+#define RADIO_LZ_H
+
+#include <exec/types.h>
+
+// Byte oriented LZ77 in the style of LZ4: a token with literal and match
+// lengths, the literals, then a 16 bit little endian match offset. Only byte
+// accesses, so it runs on a plain 68000.
+
+// Worst case compressed size for length input bytes
+#define LZ_BOUND(length) ((length) + (length) / 255 + 16)
+
+// Largest input lz_compress accepts, match positions are kept in 16 bits
+#define LZ_MAX_INPUT 65535
+
+// Returns the compressed size, dst must hold LZ_BOUND(length) bytes. 0 when
+// length is over LZ_MAX_INPUT.
+ULONG lz_compress(const UBYTE *src, ULONG length, UBYTE *dst);
+
+// FALSE unless src decodes to exactly length bytes
+BOOL lz_decompress(const UBYTE *src, ULONG src_length, UBYTE *dst, ULONG length);
+
+#endif
@@ -7,94 +7,96 @@
 #include <stdlib.h>
 #include <ctype.h>
 
-#define ALIGN __attribute__((aligned(2)))
-
-struct RadioEntry {
-    char server_name[64];
-    char server_type[16];
-    UWORD bitrate;
-    UWORD pad1;
-    ULONG samplerate;
-    UBYTE channels;
-    UBYTE pad2[3];
-    char listen_url[128];
-    char current_song[128];
-    char genre[32];
-} ALIGN;
-
-struct IndexEntry {
-    ULONG offset;
-    char server_name[64];
-} ALIGN;
-
-void load_index(const unsigned char *filename, struct IndexEntry **index, ULONG *num_entries) {
-    BPTR file = Open((CONST_STRPTR)filename, MODE_OLDFILE);
+#include "radio.h"
+#include "radio_log.h"
+#include "radio_stats.h"
+
+// Index entries read per Read() while scanning radio.idx
+#define SCAN_CHUNK 64
+
+void load_index(const unsigned char *filename, struct IndexEntry **index, ULONG *num_entries,
+                struct CatalogHeader *header) {
+    *index = NULL;
+    *num_entries = 0;
+    
+    BPTR file = radio_open((const char *)filename, MODE_OLDFILE);
     if (!file) {
-        printf("Failed to open index file: %s\n", filename);
+        log_error("Failed to open index file: %s\n", filename);
         return;
     }
     
-    LONG fileSize = Seek(file, 0, OFFSET_END);
-    if (fileSize <= 0) {
-        printf("Empty or invalid index file (size: %ld)\n", fileSize);
-        Close(file);
+    if (!read_catalog_header(file, (const char *)filename, INDEX_MAGIC,
+                             sizeof(struct IndexEntry), header)) {
+        radio_close(file);
         return;
     }
     
-    printf("Index file size: %ld bytes\n", fileSize);
-    
-    if (Seek(file, 0, OFFSET_BEGINNING) == -1) {
-        printf("Failed to seek to beginning of index file\n");
-        Close(file);
+    // The entry count comes from the header, the file size must agree
+    if (!check_catalog_size(file, (const char *)filename, header) || header->num_entries == 0) {
+        radio_close(file);
         return;
     }
     
-    *num_entries = fileSize / sizeof(struct IndexEntry);
-    printf("Calculated number of entries: %u\n", *num_entries);
+    LONG indexSize = sizeof(struct IndexEntry) * header->num_entries;
+    log_trace("Index file: %lu entries, %ld bytes\n", header->num_entries, indexSize);
     
-    *index = AllocMem(fileSize, MEMF_CLEAR);
+    *index = radio_alloc(indexSize, MEMF_ANY);
     if (!*index) {
-        printf("Failed to allocate %ld bytes for index\n", fileSize);
-        Close(file);
+        log_error("Failed to allocate %ld bytes for index\n", indexSize);
+        radio_close(file);
         return;
     }
     
-    LONG bytesRead = Read(file, *index, fileSize);
-    if (bytesRead != fileSize) {
-        printf("Failed to read index file completely (read %ld of %ld bytes)\n", 
-               bytesRead, fileSize);
-        FreeMem(*index, fileSize);
+    // Read and check in one pass over the file
+    LONG bytesRead = radio_read(file, *index, indexSize);
+    if (bytesRead != indexSize) {
+        log_error("Failed to read index file completely (read %ld of %ld bytes)\n", 
+               bytesRead, indexSize);
+    }
+    else if (crc32(0, *index, indexSize) != header->checksum) {
+        log_error("Index file %s is damaged (checksum mismatch)\n", filename);
+    }
+    else {
+        log_trace("Successfully read %ld bytes from index\n", bytesRead);
+        *num_entries = header->num_entries;
+    }
+    
+    if (*num_entries == 0) {
+        radio_free(*index, indexSize);
         *index = NULL;
-    } else {
-        printf("Successfully read %ld bytes from index\n", bytesRead);
     }
     
-    Close(file);
+    radio_close(file);
 }
 
 struct RadioEntry *load_entry(const unsigned char *filename, ULONG offset) {
     static struct RadioEntry entry;
-    BPTR file = Open((CONST_STRPTR)filename, MODE_OLDFILE);
+    
+    if (is_blocked_file((const char *)filename)) {
+        return load_block_entry((const char *)filename, offset / sizeof(struct RadioEntry));
+    }
+    
+    BPTR file = radio_open((const char *)filename, MODE_OLDFILE);
     if (!file) {
-        printf("Failed to open data file: %s\n", filename);
+        log_error("Failed to open data file: %s\n", filename);
         return NULL;
     }
     
-    if (Seek(file, offset, OFFSET_BEGINNING) == -1) {
-        printf("Failed to seek to offset %u\n", offset);
-        Close(file);
+    if (radio_seek(file, sizeof(struct CatalogHeader) + offset, OFFSET_BEGINNING) == -1) {
+        log_error("Failed to seek to offset %lu\n", (unsigned long)offset);
+        radio_close(file);
         return NULL;
     }
     
-    LONG bytesRead = Read(file, &entry, sizeof(struct RadioEntry));
+    LONG bytesRead = radio_read(file, &entry, sizeof(struct RadioEntry));
     if (bytesRead != sizeof(struct RadioEntry)) {
-        printf("Failed to read entry at offset %u (read %ld bytes)\n", 
-               offset, bytesRead);
-        Close(file);
+        log_error("Failed to read entry at offset %lu (read %ld bytes)\n", 
+               (unsigned long)offset, bytesRead);
+        radio_close(file);
         return NULL;
     }
     
-    Close(file);
+    radio_close(file);
     return &entry;
 }
 
@@ -109,10 +111,11 @@ void print_entry(struct RadioEntry *entry) {
     }
 }
 
-void search_by_name(const char *term, struct IndexEntry *index, ULONG num_entries) {
+void search_by_name(const char *term, const char *bin_filename,
+                    struct IndexEntry *index, ULONG num_entries) {
     char lcterm[64];
     char lcname[64];
-    UWORD i, j;
+    ULONG i, j;
     BOOL found = FALSE;
     
     // Convert search term to lowercase
@@ -121,7 +124,7 @@ void search_by_name(const char *term, struct IndexEntry *index, ULONG num_entrie
     }
     lcterm[i] = '\0';
     
-    printf("Searching for name: %s\n", term);
+    log_info("Searching for name: %s\n", term);
     
     for (i = 0; i < num_entries; i++) {
         // Convert station name to lowercase
@@ -131,9 +134,10 @@ void search_by_name(const char *term, struct IndexEntry *index, ULONG num_entrie
         lcname[j] = '\0';
         
         if (strstr(lcname, lcterm)) {
-            struct RadioEntry *entry = load_entry((const unsigned char *)"radio.bin", index[i].offset);
+            struct RadioEntry *entry = load_entry((const unsigned char *)bin_filename, index[i].offset);
             if (entry) {
                 print_entry(entry);
+                radio_stats.entries_matched++;
                 found = TRUE;
             }
         }
@@ -144,18 +148,44 @@ void search_by_name(const char *term, struct IndexEntry *index, ULONG num_entrie
     }
 }
 
+// Prints the entries of a cached result, as the search that found them did
+static BOOL replay_matches(const struct MatchList *matches, const char *bin_filename) {
+    BOOL found = FALSE;
+    
+    for (ULONG i = 0; i < matches->count; i++) {
+        struct RadioEntry *entry = load_entry((const unsigned char *)bin_filename,
+                                              matches->entries[i] * sizeof(struct RadioEntry));
+        if (entry) {
+            print_entry(entry);
+            radio_stats.entries_matched++;
+            found = TRUE;
+        }
+    }
+    return found;
+}
+
 void search_by_genre(const char *genre, const char *bin_filename, 
-                    struct IndexEntry *index, ULONG num_entries) {
+                    struct IndexEntry *index, ULONG num_entries, struct MatchList *matches) {
     struct RadioEntry *entry;
     BOOL found = FALSE;
     
-    printf("Searching for genre: %s\n", genre);
+    log_info("Searching for genre: %s\n", genre);
+    (void)index;
     
-    for (UWORD i = 0; i < num_entries; i++) {
-        entry = load_entry((const unsigned char *)bin_filename, index[i].offset);
-        if (entry && strstr(entry->genre, genre)) {
-            print_entry(entry);
-            found = TRUE;
+    if (matches && matches->cached) {
+        found = replay_matches(matches, bin_filename);
+    }
+    else {
+        // File order, not index order: a sorted index would jump between the
+        // blocks of a compressed radio.bin
+        for (ULONG i = 0; i < num_entries; i++) {
+            entry = load_entry((const unsigned char *)bin_filename, i * sizeof(struct RadioEntry));
+            if (entry && strstr(entry->genre, genre)) {
+                print_entry(entry);
+                radio_stats.entries_matched++;
+                match_add(matches, i);
+                found = TRUE;
+            }
         }
     }
     
@@ -165,17 +195,26 @@ void search_by_genre(const char *genre, const char *bin_filename,
 }
 
 void search_by_bitrate(UWORD min_bitrate, const char *bin_filename, 
-                      struct IndexEntry *index, ULONG num_entries) {
+                      struct IndexEntry *index, ULONG num_entries, struct MatchList *matches) {
     struct RadioEntry *entry;
     BOOL found = FALSE;
     
-    printf("Searching for bitrate >= %u\n", min_bitrate);
+    log_info("Searching for bitrate >= %u\n", min_bitrate);
+    (void)index;
     
-    for (UWORD i = 0; i < num_entries; i++) {
-        entry = load_entry((const unsigned char *)bin_filename, index[i].offset);
-        if (entry && entry->bitrate >= min_bitrate) {
-            print_entry(entry);
-            found = TRUE;
+    if (matches && matches->cached) {
+        found = replay_matches(matches, bin_filename);
+    }
+    else {
+        // File order, as in search_by_genre
+        for (ULONG i = 0; i < num_entries; i++) {
+            entry = load_entry((const unsigned char *)bin_filename, i * sizeof(struct RadioEntry));
+            if (entry && entry->bitrate >= min_bitrate) {
+                print_entry(entry);
+                radio_stats.entries_matched++;
+                match_add(matches, i);
+                found = TRUE;
+            }
         }
     }
     
@@ -184,58 +223,295 @@ void search_by_bitrate(UWORD min_bitrate, const char *bin_filename,
     }
 }
 
+// Opens radio.idx positioned at the first entry that can start with the
+// folded prefix, found through radio.spx when the index is sorted
+static BPTR open_prefix_scan(const char *lcprefix, const char *idx_filename,
+                             const char *spx_filename, struct CatalogHeader *header, BOOL *sorted) {
+    BPTR file = radio_open(idx_filename, MODE_OLDFILE);
+    if (!file) {
+        log_error("Failed to open index file: %s\n", idx_filename);
+        return 0;
+    }
+
+    if (!read_catalog_header(file, idx_filename, INDEX_MAGIC, sizeof(struct IndexEntry), header)) {
+        radio_close(file);
+        return 0;
+    }
+
+    ULONG start = find_prefix_start(spx_filename, header, lcprefix, sorted);
+    if (radio_seek(file, sizeof(*header) + start * sizeof(struct IndexEntry), OFFSET_BEGINNING) == -1) {
+        log_error("Failed to seek to index entry %lu\n", start);
+        radio_close(file);
+        return 0;
+    }
+    return file;
+}
+
+void search_by_prefix(const char *prefix, const char *idx_filename, const char *spx_filename,
+                      const char *bin_filename, ULONG limit) {
+    static struct IndexEntry chunk[SCAN_CHUNK];
+    char lcprefix[MAX_NAME];
+    char lcname[MAX_NAME];
+    struct CatalogHeader header;
+    ULONG found = 0;
+    BOOL sorted;
+    BOOL done = limit == 0;
+
+    ULONG prefix_len = fold_name(lcprefix, prefix);
+    log_info("Searching for prefix: %s\n", prefix);
+
+    BPTR file = open_prefix_scan(lcprefix, idx_filename, spx_filename, &header, &sorted);
+    if (!file) return;
+
+    if (!sorted) {
+        log_info("No sorted index, scanning all of %s\n", idx_filename);
+    }
+
+    LONG bytes_read;
+    while (!done && (bytes_read = radio_read(file, chunk, sizeof(chunk))) > 0) {
+        ULONG count = bytes_read / sizeof(struct IndexEntry);
+
+        for (ULONG i = 0; i < count && !done; i++) {
+            fold_name(lcname, chunk[i].server_name);
+            int order = strncmp(lcname, lcprefix, prefix_len);
+
+            if (order == 0) {
+                struct RadioEntry *entry = load_entry((const unsigned char *)bin_filename,
+                                                      chunk[i].offset);
+                if (entry) {
+                    print_entry(entry);
+                    radio_stats.entries_matched++;
+                    done = ++found >= limit;
+                }
+            } else if (order > 0 && sorted) {
+                done = TRUE;  // past the last possible match
+            }
+        }
+    }
+
+    radio_close(file);
+
+    if (!found) {
+        printf("No stations found starting with: %s\n", prefix);
+    }
+}
+
+struct RadioEntry *find_station(const char *name, const char *idx_filename,
+                                const char *spx_filename, const char *bin_filename) {
+    static struct IndexEntry chunk[SCAN_CHUNK];
+    char lcname[MAX_NAME];
+    char lcentry[MAX_NAME];
+    struct CatalogHeader header;
+    struct RadioEntry *entry = NULL;
+    BOOL sorted;
+    BOOL matched = FALSE;
+
+    fold_name(lcname, name);
+
+    BPTR file = open_prefix_scan(lcname, idx_filename, spx_filename, &header, &sorted);
+    if (!file) return NULL;
+
+    LONG bytes_read;
+    BOOL done = FALSE;
+    while (!done && (bytes_read = radio_read(file, chunk, sizeof(chunk))) > 0) {
+        ULONG count = bytes_read / sizeof(struct IndexEntry);
+
+        for (ULONG i = 0; i < count && !done; i++) {
+            fold_name(lcentry, chunk[i].server_name);
+            int order = strcmp(lcentry, lcname);
+
+            if (order == 0) {
+                // The first station of that name wins, from a radio.bin of the same run
+                if (check_data_file(bin_filename, &header, FALSE)) {
+                    entry = load_entry((const unsigned char *)bin_filename, chunk[i].offset);
+                }
+                matched = TRUE;
+                done = TRUE;
+            } else if (order > 0 && sorted) {
+                done = TRUE;
+            }
+        }
+    }
+
+    radio_close(file);
+
+    if (!matched) {
+        log_error("No station named: %s\n", name);
+    }
+    return entry;
+}
+
+#ifndef RADIO_BENCH
 int main(int argc, char **argv) {
-    if (argc != 3) {
-        printf("Usage: %s <search_type> <search_term>\n", argv[0]);
+    const char *args[2];
+    int num_args = 0;
+    LONG top_k = RANKED_TOP_K;
+    BOOL verify = FALSE;
+    BOOL use_cache = TRUE;
+
+    for (int i = 1; i < argc; i++) {
+        if (stats_option(argv[i])) continue;
+        if (strcmp(argv[i], "--verify") == 0) {
+            verify = TRUE;
+            continue;
+        }
+        if (strcmp(argv[i], "--nocache") == 0) {
+            use_cache = FALSE;
+            continue;
+        }
+        if (strcmp(argv[i], "--top") == 0 && i + 1 < argc) {
+            top_k = atol(argv[++i]);
+            if (top_k < 1) {
+                num_args = 0;
+                break;
+            }
+            continue;
+        }
+        if (num_args == 2) {
+            num_args = 0;
+            break;
+        }
+        args[num_args++] = argv[i];
+    }
+
+    if (num_args != 2) {
+        printf("Usage: %s [--stats] [--quiet] [--verbose] [--top <n>] [--verify] [--nocache] <search_type> <search_term>\n", argv[0]);
+        printf("  --verify      Also check the radio.bin checksum before searching\n");
+        printf("  --nocache     Always scan radio.bin for -g and -b, do not use radio.qc\n");
         printf("Search types:\n");
         printf("  -n <name>     Search by station name\n");
+        printf("  -f <name>     Best matching names first, tolerating typos\n");
+        printf("  -p <prefix>   Names starting with prefix, fast with a --sorted index\n");
         printf("  -g <genre>    Search by genre\n");
         printf("  -b <bitrate>  Search by minimum bitrate\n");
         return 1;
     }
+
+    const char *type = args[0];
+    const char *term = args[1];
+
+    if (!stats_open()) {
+        return 2;
+    }
     
     // First check if files exist
-    BPTR test = Open("PROGDIR:radio.idx", MODE_OLDFILE);
+    BPTR test = radio_open("PROGDIR:radio.idx", MODE_OLDFILE);
     if (!test) {
-        printf("Cannot find radio.idx file!\n");
+        log_error("Cannot find radio.idx file!\n");
+        stats_close();
         return 2;
     }
-    Close(test);
+    radio_close(test);
     
-    test = Open("PROGDIR:radio.bin", MODE_OLDFILE);
+    test = radio_open("PROGDIR:radio.bin", MODE_OLDFILE);
     if (!test) {
-        printf("Cannot find radio.bin file!\n");
+        log_error("Cannot find radio.bin file!\n");
+        stats_close();
         return 2;
     }
-    Close(test);
+    radio_close(test);
     
     struct IndexEntry *index = NULL;
     ULONG num_entries = 0;
+    struct CatalogHeader header;
+    BOOL prefix = strcmp(type, "-p") == 0;
+    
+    // Prefix search reads radio.idx itself, only as far as it needs, so
+    // only its header is checked here
+    stats_phase_begin("load index");
+    if (prefix) {
+        test = radio_open("PROGDIR:radio.idx", MODE_OLDFILE);
+        if (test && read_catalog_header(test, "radio.idx", INDEX_MAGIC,
+                                        sizeof(struct IndexEntry), &header) &&
+            check_catalog_size(test, "radio.idx", &header)) {
+            num_entries = header.num_entries;
+        }
+        if (test) radio_close(test);
+    }
+    else {
+        load_index((const unsigned char *)"PROGDIR:radio.idx", &index, &num_entries, &header);
+    }
+    stats_phase_end();
+    if (num_entries == 0) {
+        log_error("Failed to load index file!\n");
+        stats_close();
+        return 2;
+    }
     
-    load_index((const unsigned char *)"PROGDIR:radio.idx", &index, &num_entries);
-    if (!index) {
-        printf("Failed to load index file!\n");
+    // No more results than stations
+    if ((ULONG)top_k > num_entries) top_k = num_entries;
+    
+    stats_phase_begin(verify ? "verify data" : "check data");
+    BOOL paired = check_data_file("radio.bin", &header, verify);
+    stats_phase_end();
+    if (!paired) {
+        if (index) radio_free(index, sizeof(struct IndexEntry) * num_entries);
+        stats_close();
         return 2;
     }
     
-    printf("Loaded %u entries from index\n", num_entries);
+    if (prefix) {
+        stats_phase_begin("search");
+        search_by_prefix(term, "PROGDIR:radio.idx", "PROGDIR:radio.spx", "radio.bin", top_k);
+        stats_phase_end();
+        block_file_close();
+        
+        stats_print();
+        stats_close();
+        return 0;
+    }
+    
+    log_info("Loaded %u entries from index\n", num_entries);
     
-    if (strcmp(argv[1], "-n") == 0) {
-        search_by_name(argv[2], index, num_entries);
+    stats_phase_begin("search");
+    if (strcmp(type, "-n") == 0) {
+        search_by_name(term, "radio.bin", index, num_entries);
     }
-    else if (strcmp(argv[1], "-g") == 0) {
-        search_by_genre(argv[2], "radio.bin", index, num_entries);
+    else if (strcmp(type, "-f") == 0) {
+        search_ranked(term, "radio.bin", "PROGDIR:radio.spx", &header, index, num_entries, top_k);
     }
-    else if (strcmp(argv[1], "-b") == 0) {
-        search_by_bitrate((UWORD)atoi(argv[2]), "radio.bin", index, num_entries);
+    else if (strcmp(type, "-g") == 0 || strcmp(type, "-b") == 0) {
+        // Repeated scans of radio.bin come from radio.qc instead
+        struct MatchList matches = {0};
+        char key[CACHE_KEY];
+        char trimmed[MAX_NAME];
+        
+        // Searched for exactly as cached, so "rock " and "rock" agree
+        trim_term(trimmed, sizeof(trimmed), term);
+        term = trimmed;
+        cache_key(key, type, term);
+        if (use_cache) {
+            cache_open("radio.qc", &header);
+            cache_lookup(key, &matches);
+        }
+        
+        if (type[1] == 'g') {
+            search_by_genre(term, "radio.bin", index, num_entries, use_cache ? &matches : NULL);
+        }
+        else {
+            search_by_bitrate((UWORD)atoi(term), "radio.bin", index, num_entries,
+                              use_cache ? &matches : NULL);
+        }
+        
+        if (use_cache) {
+            cache_store(key, &matches);
+            cache_close();
+            match_free(&matches);
+        }
     }
     else {
-        printf("Invalid search type!\n");
+        log_error("Invalid search type!\n");
     }
+    stats_phase_end();
+    block_file_close();
     
     if (index) {
-        FreeMem(index, sizeof(struct IndexEntry) * num_entries);
+        radio_free(index, sizeof(struct IndexEntry) * num_entries);
     }
+
+    stats_print();
+    stats_close();
     
     return 0;
-}
\ No newline at end of file
+}
+#endif
@@ -0,0 +1,179 @@
+#include <exec/types.h>
+#include <exec/memory.h>
+#include <devices/timer.h>
+#include <proto/exec.h>
+#include <proto/dos.h>
+#include <proto/timer.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "radio_log.h"
+#include "radio_stats.h"
+#ifdef TIMER_UTIL
+#include "timer_util.h"
+#endif
+
+int log_level = LOG_INFO;
+struct RadioStats radio_stats;
+
+#ifdef TIMER_UTIL
+// Linked into tunebench next to mp3player's timer_util.c: time with its
+// timer.device rather than open a second one
+BOOL timer_open(void) {
+    return timerOpen();
+}
+
+void timer_close(void) {
+    timerClose();
+}
+
+void timer_now(struct EClockVal *t) {
+    timerNow(t);
+}
+
+ULONG timer_micros(const struct EClockVal *start, const struct EClockVal *end) {
+    return timerMicros(start, end);
+}
+#else
+struct Device *TimerBase = NULL;
+static struct timerequest timer_io;
+static ULONG eclock_freq;
+static UWORD timer_users = 0;
+
+BOOL timer_open(void) {
+    if (timer_users == 0) {
+        if (OpenDevice((STRPTR)TIMERNAME, UNIT_ECLOCK, (struct IORequest *)&timer_io, 0)) {
+            return FALSE;
+        }
+        TimerBase = timer_io.tr_node.io_Device;
+    }
+    timer_users++;
+    return TRUE;
+}
+
+void timer_close(void) {
+    if (timer_users && --timer_users == 0) {
+        CloseDevice((struct IORequest *)&timer_io);
+        TimerBase = NULL;
+    }
+}
+
+void timer_now(struct EClockVal *t) {
+    eclock_freq = ReadEClock(t);
+}
+
+ULONG timer_micros(const struct EClockVal *start, const struct EClockVal *end) {
+    unsigned long long s = ((unsigned long long)start->ev_hi << 32) | start->ev_lo;
+    unsigned long long e = ((unsigned long long)end->ev_hi << 32) | end->ev_lo;
+    return (ULONG)((e - s) * 1000000ULL / eclock_freq);
+}
+#endif
+
+BOOL stats_option(const char *arg) {
+    if (strcmp(arg, "--stats") == 0) {
+        radio_stats.enabled = TRUE;
+    } else if (strcmp(arg, "--quiet") == 0) {
+        log_level = LOG_ERROR;
+    } else if (strcmp(arg, "--verbose") == 0) {
+        log_level = LOG_TRACE;
+    } else {
+        return FALSE;
+    }
+    return TRUE;
+}
+
+BOOL stats_open(void) {
+    if (!radio_stats.enabled) return TRUE;
+
+    if (!timer_open()) {
+        log_error("Could not open %s for --stats\n", TIMERNAME);
+        radio_stats.enabled = FALSE;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void stats_close(void) {
+    if (radio_stats.enabled) {
+        timer_close();
+    }
+}
+
+void stats_phase_begin(const char *name) {
+    if (!radio_stats.enabled || radio_stats.phases >= STATS_MAX_PHASES) return;
+
+    radio_stats.phase[radio_stats.phases].name = name;
+    timer_now(&radio_stats.phase_start);
+}
+
+void stats_phase_end(void) {
+    struct EClockVal now;
+
+    if (!radio_stats.enabled || radio_stats.phases >= STATS_MAX_PHASES) return;
+
+    timer_now(&now);
+    radio_stats.phase[radio_stats.phases++].micros = timer_micros(&radio_stats.phase_start, &now);
+}
+
+void stats_print(void) {
+    ULONG total = 0;
+
+    if (!radio_stats.enabled) return;
+
+    printf("\nPhase              Time ms\n");
+    for (UWORD i = 0; i < radio_stats.phases; i++) {
+        printf("%-18s %4lu.%03lu\n", radio_stats.phase[i].name,
+               radio_stats.phase[i].micros / 1000, radio_stats.phase[i].micros % 1000);
+        total += radio_stats.phase[i].micros;
+    }
+    printf("%-18s %4lu.%03lu\n", "total", total / 1000, total % 1000);
+
+    printf("Bytes read:        %lu\n", radio_stats.bytes_read);
+    printf("Bytes written:     %lu\n", radio_stats.bytes_written);
+    printf("Entries parsed:    %lu\n", radio_stats.entries_parsed);
+    printf("Entries matched:   %lu\n", radio_stats.entries_matched);
+    printf("DOS calls:         %lu\n", radio_stats.dos_calls);
+    printf("Allocations:       %lu (%lu bytes)\n", radio_stats.allocations, radio_stats.alloc_bytes);
+}
+
+BPTR radio_open(const char *name, LONG mode) {
+    radio_stats.dos_calls++;
+    return Open((CONST_STRPTR)name, mode);
+}
+
+LONG radio_read(BPTR file, APTR buffer, LONG length) {
+    radio_stats.dos_calls++;
+    LONG result = Read(file, buffer, length);
+    if (result > 0) radio_stats.bytes_read += result;
+    return result;
+}
+
+LONG radio_write(BPTR file, APTR buffer, LONG length) {
+    radio_stats.dos_calls++;
+    LONG result = Write(file, buffer, length);
+    if (result > 0) radio_stats.bytes_written += result;
+    return result;
+}
+
+LONG radio_seek(BPTR file, LONG position, LONG mode) {
+    radio_stats.dos_calls++;
+    return Seek(file, position, mode);
+}
+
+void radio_close(BPTR file) {
+    radio_stats.dos_calls++;
+    Close(file);
+}
+
+APTR radio_alloc(ULONG size, ULONG requirements) {
+    APTR memory = AllocMem(size, requirements);
+    if (memory) {
+        radio_stats.allocations++;
+        radio_stats.alloc_bytes += size;
+    }
+    return memory;
+}
+
+void radio_free(APTR memory, ULONG size) {
+    FreeMem(memory, size);
+}
@@ -0,0 +1,57 @@
+#ifndef RADIO_STATS_H
+#define RADIO_STATS_H
+
+#include <exec/types.h>
+#include <dos/dos.h>
+#include <devices/timer.h>
+
+#define STATS_MAX_PHASES 8
+
+struct StatsPhase {
+    const char *name;
+    ULONG micros;
+};
+
+// Counters are always kept, --stats adds phase timing and the report
+struct RadioStats {
+    BOOL enabled;
+    UWORD phases;
+    struct StatsPhase phase[STATS_MAX_PHASES];
+    struct EClockVal phase_start;
+
+    ULONG bytes_read;
+    ULONG bytes_written;
+    ULONG entries_parsed;
+    ULONG entries_matched;
+    ULONG dos_calls;
+    ULONG allocations;
+    ULONG alloc_bytes;
+};
+
+extern struct RadioStats radio_stats;
+
+// E-clock timing
+BOOL timer_open(void);
+void timer_close(void);
+void timer_now(struct EClockVal *t);
+ULONG timer_micros(const struct EClockVal *start, const struct EClockVal *end);
+
+// Handles --stats, --quiet and --verbose. FALSE for anything else.
+BOOL stats_option(const char *arg);
+
+BOOL stats_open(void);
+void stats_close(void);
+void stats_phase_begin(const char *name);
+void stats_phase_end(void);
+void stats_print(void);
+
+// Counted dos.library and memory calls
+BPTR radio_open(const char *name, LONG mode);
+LONG radio_read(BPTR file, APTR buffer, LONG length);
+LONG radio_write(BPTR file, APTR buffer, LONG length);
+LONG radio_seek(BPTR file, LONG position, LONG mode);
+void radio_close(BPTR file);
+APTR radio_alloc(ULONG size, ULONG requirements);
+void radio_free(APTR memory, ULONG size);
+
+#endif
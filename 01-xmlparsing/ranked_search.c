@@ -0,0 +1,238 @@
+#include <exec/types.h>
+#include <exec/memory.h>
+#include <proto/exec.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "radio.h"
+#include "radio_log.h"
+#include "radio_stats.h"
+
+// Score tiers, best first. Within a tier closer matches score higher.
+#define SCORE_EXACT     4000
+#define SCORE_PREFIX    3000
+#define SCORE_SUBSTRING 2000
+#define SCORE_FUZZY     1000
+#define TIER_RANGE      999
+
+#define MAX_DISTANCE 3
+
+struct RankedMatch {
+    ULONG entry;
+    LONG score;
+};
+
+// One bit per letter, digits share bit 26, everything else bit 27
+static ULONG char_mask(const char *s) {
+    ULONG mask = 0;
+    for (; *s; s++) {
+        if (*s >= 'a' && *s <= 'z') mask |= 1UL << (*s - 'a');
+        else if (*s >= '0' && *s <= '9') mask |= 1UL << 26;
+        else mask |= 1UL << 27;
+    }
+    return mask;
+}
+
+static UWORD count_bits(ULONG mask) {
+    UWORD bits = 0;
+    for (; mask; mask &= mask - 1) bits++;
+    return bits;
+}
+
+// Fewest edits turning term into any substring of name (Sellers), capped
+// at max + 1
+static UWORD substring_distance(const char *term, ULONG term_len,
+                                const char *name, ULONG name_len, UWORD max) {
+    UBYTE column[MAX_NAME];
+
+    // column[i]: edits for term[0..i) ending at the current name position
+    for (ULONG i = 0; i <= term_len; i++) column[i] = (UBYTE)i;
+    UWORD best = column[term_len];
+
+    for (ULONG j = 0; j < name_len && best > 0; j++) {
+        UBYTE diagonal = column[0];
+
+        column[0] = 0;  // a match may start anywhere in the name
+        for (ULONG i = 1; i <= term_len; i++) {
+            UBYTE above = column[i];
+            UBYTE cost = diagonal + (term[i - 1] != name[j]);
+
+            if (above + 1 < cost) cost = above + 1;
+            if (column[i - 1] + 1 < cost) cost = column[i - 1] + 1;
+
+            diagonal = above;
+            column[i] = cost;
+        }
+
+        if (column[term_len] < best) best = column[term_len];
+    }
+    return best > max ? max + 1 : best;
+}
+
+static LONG score_name(const char *term, ULONG term_len, ULONG term_mask, UWORD max_distance,
+                       const char *name, ULONG name_len) {
+    LONG extra = (LONG)name_len - (LONG)term_len;
+
+    if (extra == 0 && strcmp(name, term) == 0) return SCORE_EXACT;
+
+    if (extra > 0) {
+        if (strncmp(name, term, term_len) == 0) {
+            return SCORE_PREFIX + TIER_RANGE - (extra < TIER_RANGE ? extra : TIER_RANGE);
+        }
+
+        const char *found = strstr(name, term);
+        if (found) {
+            LONG penalty = (found - name) * 8 + extra;
+            return SCORE_SUBSTRING + TIER_RANGE - (penalty < TIER_RANGE ? penalty : TIER_RANGE);
+        }
+    }
+
+    if (max_distance == 0) return 0;
+
+    // Prune on the index name before the edit distance: every character of
+    // the term missing from the name costs at least one edit
+    if (count_bits(term_mask & ~char_mask(name)) > max_distance) return 0;
+
+    UWORD distance = substring_distance(term, term_len, name, name_len, max_distance);
+    if (distance > max_distance) return 0;
+
+    LONG penalty = distance * 200 + (extra > 0 ? extra : -extra);
+    return SCORE_FUZZY + TIER_RANGE - (penalty < TIER_RANGE ? penalty : TIER_RANGE);
+}
+
+// Min-heap on score, so the weakest of the kept matches is at the top
+static BOOL weaker(const struct RankedMatch *a, const struct RankedMatch *b) {
+    return a->score < b->score || (a->score == b->score && a->entry > b->entry);
+}
+
+static void sift_down(struct RankedMatch *heap, ULONG count, ULONG i) {
+    for (;;) {
+        ULONG smallest = i;
+        ULONG left = i * 2 + 1;
+        ULONG right = left + 1;
+
+        if (left < count && weaker(&heap[left], &heap[smallest])) smallest = left;
+        if (right < count && weaker(&heap[right], &heap[smallest])) smallest = right;
+        if (smallest == i) return;
+
+        struct RankedMatch tmp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+static void sift_up(struct RankedMatch *heap, ULONG i) {
+    while (i > 0) {
+        ULONG parent = (i - 1) / 2;
+        if (!weaker(&heap[i], &heap[parent])) return;
+
+        struct RankedMatch tmp = heap[i];
+        heap[i] = heap[parent];
+        heap[parent] = tmp;
+        i = parent;
+    }
+}
+
+// Keeps the top_k strongest matches offered so far
+static void offer_match(struct RankedMatch *heap, ULONG *count, ULONG top_k,
+                        const struct RankedMatch *match) {
+    if (*count < top_k) {
+        heap[*count] = *match;
+        sift_up(heap, (*count)++);
+    } else if (weaker(&heap[0], match)) {
+        heap[0] = *match;
+        sift_down(heap, *count, 0);
+    }
+}
+
+static void score_range(const char *lcterm, ULONG term_len, ULONG term_mask, UWORD max_distance,
+                        struct IndexEntry *index, ULONG first, ULONG last,
+                        struct RankedMatch *heap, ULONG *count, ULONG top_k) {
+    char lcname[MAX_NAME];
+
+    for (ULONG i = first; i < last; i++) {
+        ULONG name_len = fold_name(lcname, index[i].server_name);
+        LONG score = score_name(lcterm, term_len, term_mask, max_distance, lcname, name_len);
+        if (score == 0) continue;
+
+        radio_stats.entries_matched++;
+        struct RankedMatch match = {i, score};
+        offer_match(heap, count, top_k, &match);
+    }
+}
+
+void search_ranked(const char *term, const char *bin_filename, const char *spx_filename,
+                   const struct CatalogHeader *index_header,
+                   struct IndexEntry *index, ULONG num_entries, ULONG top_k) {
+    char lcterm[MAX_NAME];
+    char lcname[MAX_NAME];
+    ULONG count = 0;
+    BOOL sorted;
+
+    ULONG term_len = fold_name(lcterm, term);
+    ULONG term_mask = char_mask(lcterm);
+
+    // About one typo per four characters
+    UWORD max_distance = term_len / 4;
+    if (max_distance > MAX_DISTANCE) max_distance = MAX_DISTANCE;
+
+    log_info("Ranked search for name: %s (top %lu)\n", term, top_k);
+
+    if (top_k > num_entries) top_k = num_entries;
+    if (term_len == 0 || top_k == 0) return;
+
+    struct RankedMatch *heap = radio_alloc(sizeof(struct RankedMatch) * top_k, MEMF_ANY);
+    if (!heap) {
+        log_error("Failed to allocate %lu result slots\n", top_k);
+        return;
+    }
+
+    // In a sorted index every exact and prefix match lies in one run,
+    // found through radio.spx. It starts up to a sparse block early.
+    ULONG first = find_prefix_start(spx_filename, index_header, lcterm, &sorted);
+    ULONG last = first;
+    if (sorted) {
+        while (last < num_entries) {
+            fold_name(lcname, index[last].server_name);
+            if (strncmp(lcname, lcterm, term_len) > 0) break;
+            last++;
+        }
+        score_range(lcterm, term_len, term_mask, max_distance, index, first, last,
+                    heap, &count, top_k);
+    }
+
+    // Names outside the run score below SCORE_PREFIX, so once top_k
+    // prefix matches are kept they cannot rank
+    if (count < top_k || heap[0].score < SCORE_PREFIX) {
+        score_range(lcterm, term_len, term_mask, max_distance, index, 0, first,
+                    heap, &count, top_k);
+        score_range(lcterm, term_len, term_mask, max_distance, index, last, num_entries,
+                    heap, &count, top_k);
+    } else {
+        log_trace("Top %lu from entries %lu to %lu of the sorted index\n", top_k, first, last);
+    }
+
+    if (count == 0) {
+        printf("No stations found matching: %s\n", term);
+    }
+
+    // Popping the min-heap leaves the best match at the front
+    for (ULONG n = count; n > 1; n--) {
+        struct RankedMatch tmp = heap[0];
+        heap[0] = heap[n - 1];
+        heap[n - 1] = tmp;
+        sift_down(heap, n - 1, 0);
+    }
+
+    for (ULONG n = 0; n < count; n++) {
+        struct RadioEntry *entry = load_entry((const unsigned char *)bin_filename,
+                                              index[heap[n].entry].offset);
+        if (entry) {
+            printf("\n#%lu (score %ld)", n + 1, heap[n].score);
+            print_entry(entry);
+        }
+    }
+
+    radio_free(heap, sizeof(struct RankedMatch) * top_k);
+}
@@ -6,25 +6,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-#define ALIGN __attribute__((aligned(2)))
+#include "radio.h"
+#include "radio_log.h"
+#include "radio_stats.h"
 
-struct RadioEntry {
-    char server_name[64];
-    char server_type[16];
-    UWORD bitrate;
-    UWORD pad1;
-    ULONG samplerate;
-    UBYTE channels;
-    UBYTE pad2[3];
-    char listen_url[128];
-    char current_song[128];
-    char genre[32];
-} ALIGN;
-
-struct IndexEntry {
-    ULONG offset;
-    char server_name[64];
-} ALIGN;
+#define COUNT_BUFFER_SIZE 4096
 
 struct ParseState {
     char current_tag[32];
@@ -52,7 +38,7 @@ void store_field(struct RadioEntry *entry, const char *tag, const char *content)
     
     if (len == 0) return;  // Skip empty content
     
-    printf("Storing field: %s = %s\n", tag, content);
+    log_trace("Storing field: %s = %s\n", tag, content);
     
     if (strcmp(tag, "server_name") == 0) {
         strncpy(entry->server_name, content, sizeof(entry->server_name) - 1);
@@ -78,7 +64,8 @@ void store_field(struct RadioEntry *entry, const char *tag, const char *content)
     }
 }
 
-BOOL process_xml(BPTR file, struct RadioEntry *entries, struct IndexEntry *index, ULONG *num_entries) {
+BOOL process_xml(BPTR file, struct RadioEntry *entries, struct IndexEntry *index,
+                 ULONG max_entries, ULONG *num_entries) {
     struct ParseState state;
     UBYTE buffer[4096];
     LONG bytes_read;
@@ -90,10 +77,10 @@ BOOL process_xml(BPTR file, struct RadioEntry *entries, struct IndexEntry *index
     memset(&current_entry, 0, sizeof(struct RadioEntry));
     init_parse_state(&state, &current_entry);
     
-    printf("Starting XML processing...\n");
+    log_info("Starting XML processing...\n");
     
-    while ((bytes_read = Read(file, buffer, sizeof(buffer))) > 0) {
-        printf("Read %ld bytes from XML\n", bytes_read);
+    while ((bytes_read = radio_read(file, buffer, sizeof(buffer))) > 0) {
+        log_trace("Read %ld bytes from XML\n", bytes_read);
         
         for (LONG i = 0; i < bytes_read; i++) {
             char c = (char)buffer[i];
@@ -119,19 +106,24 @@ BOOL process_xml(BPTR file, struct RadioEntry *entries, struct IndexEntry *index
                     memset(&current_entry, 0, sizeof(struct RadioEntry));
                 }
                 else if (strcmp(state.current_tag, "/entry") == 0) {
-                    if (in_entry && current_entry.server_name[0] != '\0') {
-                        printf("Found complete entry: %s\n", current_entry.server_name);
+                    if (in_entry && current_entry.server_name[0] != '\0' &&
+                        *num_entries >= max_entries) {
+                        log_error("Entry table full, skipping: %s\n", current_entry.server_name);
+                    }
+                    else if (in_entry && current_entry.server_name[0] != '\0') {
+                        log_trace("Found complete entry: %s\n", current_entry.server_name);
                         
                         // Store the entry
                         CopyMem(&current_entry, &entries[*num_entries], sizeof(struct RadioEntry));
                         
                         // Update index
                         index[*num_entries].offset = *num_entries * sizeof(struct RadioEntry);
-                        strncpy(index[*num_entries].server_name, current_entry.server_name, 63);
+                        CopyMem(current_entry.server_name, index[*num_entries].server_name, 63);
                         index[*num_entries].server_name[63] = '\0';
                         
                         (*num_entries)++;
-                        printf("Total entries so far: %u\n", *num_entries);
+                        radio_stats.entries_parsed++;
+                        log_trace("Total entries so far: %u\n", *num_entries);
                     }
                     in_entry = FALSE;
                 }
@@ -151,106 +143,236 @@ BOOL process_xml(BPTR file, struct RadioEntry *entries, struct IndexEntry *index
         }
     }
     
-    printf("Finished XML processing. Found %u entries.\n", *num_entries);
+    log_info("Finished XML processing. Found %lu entries.\n", (unsigned long)*num_entries);
     return *num_entries > 0;
 }
 
-BOOL save_binary_format(const char *filename, struct RadioEntry *entries, ULONG num_entries) {
-    printf("Saving binary file: %s (entries: %u)\n", filename, num_entries);
+BOOL save_binary_format(const char *filename, struct RadioEntry *entries, ULONG num_entries,
+                        const struct CatalogBuild *build) {
+    log_info("Saving binary file: %s (entries: %lu)\n", filename, (unsigned long)num_entries);
     
-    BPTR file = Open((CONST_STRPTR)filename, MODE_NEWFILE);
+    BPTR file = radio_open(filename, MODE_NEWFILE);
     if (!file) {
-        printf("Failed to create binary file\n");
+        log_error("Failed to create binary file\n");
         return FALSE;
     }
     
+    struct CatalogHeader header;
     LONG bytes_to_write = sizeof(struct RadioEntry) * num_entries;
-    LONG bytes_written = Write(file, entries, bytes_to_write);
+    
+    catalog_header(&header, DATA_MAGIC, sizeof(struct RadioEntry), num_entries, build);
+    header.checksum = crc32(0, entries, bytes_to_write);
+    
+    LONG bytes_written = radio_write(file, &header, sizeof(header));
+    if (bytes_written == sizeof(header)) {
+        bytes_written = radio_write(file, entries, bytes_to_write);
+    }
     
     if (bytes_written != bytes_to_write) {
-        printf("Failed to write binary file: wrote %ld of %ld bytes\n",
+        log_error("Failed to write binary file: wrote %ld of %ld bytes\n",
                 bytes_written, bytes_to_write);
-        Close(file);
+        radio_close(file);
         return FALSE;
     }
     
-    printf("Successfully wrote %ld bytes to binary file\n", bytes_written);
-    Close(file);
+    log_info("Successfully wrote %ld bytes to binary file\n", bytes_written);
+    radio_close(file);
     return TRUE;
 }
 
-BOOL save_index(const char *filename, struct IndexEntry *index, ULONG num_entries) {
-    printf("Saving index file: %s (entries: %u)\n", filename, num_entries);
+BOOL save_index(const char *filename, struct IndexEntry *index, ULONG num_entries,
+                const struct CatalogBuild *build) {
+    log_info("Saving index file: %s (entries: %lu)\n", filename, (unsigned long)num_entries);
     
-    BPTR file = Open((CONST_STRPTR)filename, MODE_NEWFILE);
+    BPTR file = radio_open(filename, MODE_NEWFILE);
     if (!file) {
-        printf("Failed to create index file\n");
+        log_error("Failed to create index file\n");
         return FALSE;
     }
     
+    struct CatalogHeader header;
     LONG bytes_to_write = sizeof(struct IndexEntry) * num_entries;
-    LONG bytes_written = Write(file, index, bytes_to_write);
+    
+    catalog_header(&header, INDEX_MAGIC, sizeof(struct IndexEntry), num_entries, build);
+    header.checksum = crc32(0, index, bytes_to_write);
+    
+    LONG bytes_written = radio_write(file, &header, sizeof(header));
+    if (bytes_written == sizeof(header)) {
+        bytes_written = radio_write(file, index, bytes_to_write);
+    }
     
     if (bytes_written != bytes_to_write) {
-        printf("Failed to write index file: wrote %ld of %ld bytes\n",
+        log_error("Failed to write index file: wrote %ld of %ld bytes\n",
                 bytes_written, bytes_to_write);
-        Close(file);
+        radio_close(file);
         return FALSE;
     }
     
-    printf("Successfully wrote %ld bytes to index file\n", bytes_written);
-    Close(file);
+    log_info("Successfully wrote %ld bytes to index file\n", bytes_written);
+    radio_close(file);
     return TRUE;
 }
 
+ULONG count_entries(const char *filename, ULONG *file_size) {
+    static UBYTE buffer[COUNT_BUFFER_SIZE];
+    ULONG count = 0;
+    ULONG matched = 0;
+    const char *tag = "<entry>";
+    LONG len;
+
+    *file_size = 0;
+    BPTR file = radio_open(filename, MODE_OLDFILE);
+    if (!file) return 0;
+
+    while ((len = radio_read(file, buffer, sizeof(buffer))) > 0) {
+        *file_size += len;
+        for (LONG i = 0; i < len; i++) {
+            if (buffer[i] == tag[matched]) {
+                if (tag[++matched] == '\0') {
+                    count++;
+                    matched = 0;
+                }
+            } else {
+                matched = buffer[i] == tag[0] ? 1 : 0;
+            }
+        }
+    }
+
+    radio_close(file);
+    return count;
+}
+
+#ifndef RADIO_BENCH
 int main(int argc, char **argv) {
-    if (argc != 2) {
-        printf("Usage: %s <xml_file>\n", argv[0]);
+    const char *xml_file = NULL;
+    BOOL sorted = FALSE;
+    BOOL compress = FALSE;
+
+    for (int i = 1; i < argc; i++) {
+        if (stats_option(argv[i])) continue;
+        if (strcmp(argv[i], "--sorted") == 0) {
+            sorted = TRUE;
+            continue;
+        }
+        if (strcmp(argv[i], "--compress") == 0) {
+            compress = TRUE;
+            continue;
+        }
+        if (xml_file || argv[i][0] == '-') {
+            xml_file = NULL;
+            break;
+        }
+        xml_file = argv[i];
+    }
+
+    if (!xml_file) {
+        printf("Usage: %s [--stats] [--quiet] [--verbose] [--sorted] [--compress] <xml_file>\n", argv[0]);
+        printf("  --sorted    Sort radio.idx by name and write radio.spx for prefix search\n");
+        printf("  --compress  Write radio.bin as LZ compressed blocks of %d entries\n", BLOCK_ENTRIES);
         return 1;
     }
+
+    if (!stats_open()) {
+        return 2;
+    }
+
+    // The tables are sized by a first pass over the file
+    ULONG file_size;
+    ULONG capacity = count_entries(xml_file, &file_size);
+    if (capacity == 0) {
+        log_error("No entries in %s\n", xml_file);
+        stats_close();
+        return 3;
+    }
     
-    printf("Allocating memory for entries and index...\n");
+    log_trace("Allocating memory for %lu entries and index (%lu byte file)...\n",
+              capacity, file_size);
     
-    struct RadioEntry *entries = AllocMem(sizeof(struct RadioEntry) * 1000, MEMF_CLEAR);
-    struct IndexEntry *index = AllocMem(sizeof(struct IndexEntry) * 1000, MEMF_CLEAR);
+    ULONG entries_size = sizeof(struct RadioEntry) * capacity;
+    ULONG index_size = sizeof(struct IndexEntry) * capacity;
+    struct RadioEntry *entries = radio_alloc(entries_size, MEMF_CLEAR);
+    struct IndexEntry *index = radio_alloc(index_size, MEMF_CLEAR);
     
     if (!entries || !index) {
-        printf("Memory allocation failed!\n");
+        log_error("Memory allocation failed!\n");
+        if (entries) radio_free(entries, entries_size);
+        if (index) radio_free(index, index_size);
+        stats_close();
         return 2;
     }
     
-    printf("Opening input file: %s\n", argv[1]);
+    log_trace("Opening input file: %s\n", xml_file);
     
-    BPTR file = Open((CONST_STRPTR)argv[1], MODE_OLDFILE);
+    BPTR file = radio_open(xml_file, MODE_OLDFILE);
     if (!file) {
-        printf("Could not open input file!\n");
-        FreeMem(entries, sizeof(struct RadioEntry) * 1000);
-        FreeMem(index, sizeof(struct IndexEntry) * 1000);
+        log_error("Could not open input file!\n");
+        radio_free(entries, entries_size);
+        radio_free(index, index_size);
+        stats_close();
         return 3;
     }
     
     ULONG num_entries;
-    BOOL success = process_xml(file, entries, index, &num_entries);
-    Close(file);
+    stats_phase_begin("parse");
+    BOOL success = process_xml(file, entries, index, capacity, &num_entries);
+    stats_phase_end();
+    radio_close(file);
     
     if (success && num_entries > 0) {
-        printf("Processing completed. Saving %u entries...\n", num_entries);
+        log_info("Processing completed. Saving %u entries...\n", num_entries);
         
-        BOOL save_success = save_binary_format("radio.bin", entries, num_entries);
+        // One stamp and data checksum tie the files of this run together
+        struct CatalogBuild build;
+        catalog_build(&build, entries, num_entries);
+        
+        stats_phase_begin("save binary");
+        BOOL save_success = compress ?
+            save_blocked_format("radio.bin", entries, num_entries, &build) :
+            save_binary_format("radio.bin", entries, num_entries, &build);
+        stats_phase_end();
         if (!save_success) {
-            printf("Failed to save binary file!\n");
+            log_error("Failed to save binary file!\n");
+        }
+        
+        if (sorted) {
+            stats_phase_begin("sort index");
+            sort_index(index, num_entries);
+            stats_phase_end();
         }
         
-        save_success = save_index("radio.idx", index, num_entries);
+        stats_phase_begin("save index");
+        save_success = save_index("radio.idx", index, num_entries, &build);
+        stats_phase_end();
         if (!save_success) {
-            printf("Failed to save index file!\n");
+            log_error("Failed to save index file!\n");
+        }
+        
+        if (sorted && save_success) {
+            stats_phase_begin("save sparse index");
+            save_success = save_sparse_index("radio.spx", index, num_entries, &build);
+            stats_phase_end();
+            if (!save_success) {
+                log_error("Failed to save sparse index file!\n");
+            }
+        }
+        else {
+            // A radio.spx left from a sorted run no longer matches radio.idx
+            DeleteFile((CONST_STRPTR)"radio.spx");
         }
+        
+        // Cached results are for the old catalog; radiosearch would also
+        // notice the new build stamp, this just frees the space
+        DeleteFile((CONST_STRPTR)"radio.qc");
     } else {
-        printf("No entries found or processing failed!\n");
+        log_error("No entries found or processing failed!\n");
     }
     
-    FreeMem(entries, sizeof(struct RadioEntry) * 1000);
-    FreeMem(index, sizeof(struct IndexEntry) * 1000);
+    radio_free(entries, entries_size);
+    radio_free(index, index_size);
+
+    stats_print();
+    stats_close();
     
     return 0;
-}
\ No newline at end of file
+}
+#endif
@@ -0,0 +1,17 @@
+#include <string.h>
+
+#include "audio_sink.h"
+
+static struct AudioSink *sinks[] = {
+    &ahiSink,
+    &nullSink,
+    &wavSink,
+    NULL
+};
+
+struct AudioSink *findSink(const char *name) {
+    for (int i = 0; sinks[i]; i++) {
+        if (strcmp(sinks[i]->name, name) == 0) return sinks[i];
+    }
+    return NULL;
+}
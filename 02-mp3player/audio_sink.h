@@ -0,0 +1,42 @@
+#ifndef AUDIO_SINK_H
+#define AUDIO_SINK_H
+
+#include <exec/types.h>
+
+#define SINK_BUFFERS 2
+
+// Output backend for decoded 16-bit interleaved PCM. The player fills in
+// the format and buffers, calls open(), then loops getBuffer()/submit().
+struct AudioSink {
+    const char *name;
+    BOOL variableRate;      // frequency may change between submits
+
+    BOOL (*open)(struct AudioSink *sink, const char *target);
+    // Buffer the next submit() expects to be decoded into
+    WORD *(*getBuffer)(struct AudioSink *sink);
+    // Queue length interleaved samples. FALSE on error or break,
+    // with IoErr() set.
+    BOOL (*submit)(struct AudioSink *sink, WORD *buffer, ULONG length);
+    // Wait until everything queued has been played
+    void (*drain)(struct AudioSink *sink);
+    // Release the backend, aborting anything still queued
+    void (*close)(struct AudioSink *sink);
+
+    // Set by the player before open()
+    LONG frequency;
+    WORD channels;
+    WORD *buffers[SINK_BUFFERS];
+    ULONG bufferSize;       // in WORDs
+
+    // Maintained by the sink
+    ULONG framesWritten;    // sample frames accepted by submit()
+};
+
+extern struct AudioSink ahiSink;
+extern struct AudioSink nullSink;
+extern struct AudioSink wavSink;
+
+// Look up a sink by name, NULL if unknown
+struct AudioSink *findSink(const char *name);
+
+#endif
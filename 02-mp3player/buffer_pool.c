@@ -0,0 +1,37 @@
+#include <exec/memory.h>
+#include <proto/exec.h>
+
+#include "buffer_pool.h"
+
+BOOL poolCreate(struct BufferPool *pool, ULONG size, ULONG requirements) {
+    // The slack lets the first block start aligned whatever AllocMem returns
+    pool->size = POOL_BLOCK(size) + POOL_ALIGN;
+    pool->used = 0;
+    pool->memory = AllocMem(pool->size, requirements | MEMF_CLEAR);
+
+    if (!pool->memory && (requirements & (MEMF_FAST | MEMF_CHIP))) {
+        pool->memory = AllocMem(pool->size, MEMF_PUBLIC | MEMF_CLEAR);
+    }
+
+    if (pool->memory) {
+        pool->used = (POOL_ALIGN - ((ULONG)pool->memory & (POOL_ALIGN - 1))) & (POOL_ALIGN - 1);
+    }
+    return pool->memory != NULL;
+}
+
+void poolDelete(struct BufferPool *pool) {
+    if (pool->memory) {
+        FreeMem(pool->memory, pool->size);
+        pool->memory = NULL;
+    }
+}
+
+APTR poolTake(struct BufferPool *pool, ULONG size) {
+    ULONG block = POOL_BLOCK(size);
+
+    if (!pool->memory || pool->used + block > pool->size) return NULL;
+
+    APTR p = pool->memory + pool->used;
+    pool->used += block;
+    return p;
+}
@@ -0,0 +1,27 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <exec/types.h>
+
+// Carved blocks start on cache line boundaries of the 68040/060
+#define POOL_ALIGN 16
+
+// One AllocMem() holding several buffers that live as long as the pool
+struct BufferPool {
+    UBYTE *memory;
+    ULONG size;
+    ULONG used;
+};
+
+// Bytes a block of size takes in a pool, including alignment
+#define POOL_BLOCK(size) (((size) + POOL_ALIGN - 1) & ~(ULONG)(POOL_ALIGN - 1))
+
+// Allocate size bytes of cleared memory. With MEMF_FAST or MEMF_CHIP in
+// requirements and none of it free, any public memory is taken instead.
+BOOL poolCreate(struct BufferPool *pool, ULONG size, ULONG requirements);
+void poolDelete(struct BufferPool *pool);
+
+// Next aligned block of the pool, NULL when it is used up
+APTR poolTake(struct BufferPool *pool, ULONG size);
+
+#endif
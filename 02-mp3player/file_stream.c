@@ -0,0 +1,56 @@
+#include <dos/dos.h>
+#include <proto/dos.h>
+#include <clib/alib_protos.h>
+#include <string.h>
+
+#include "include/libraries/mpega.h"
+#include "file_stream.h"
+
+static LONG seekOverride = -1;
+
+void setSeekOverride(LONG offset) {
+    seekOverride = offset;
+}
+
+static BPTR openFile(const char *name, LONG *streamSize) {
+    BPTR file = Open((CONST_STRPTR)name, MODE_OLDFILE);
+    if (!file) return 0;
+
+    Seek(file, 0, OFFSET_END);
+    *streamSize = Seek(file, 0, OFFSET_BEGINNING);
+    if (*streamSize < 0) *streamSize = 0;
+    return file;
+}
+
+static ULONG __saveds fileHookFunc(struct Hook *hook, APTR handle, MPEGA_ACCESS *access) {
+    BPTR file = (BPTR)handle;
+    (void)hook;
+
+    switch (access->func) {
+    case MPEGA_BSFUNC_OPEN:
+        return (ULONG)openFile(access->data.open.stream_name,
+                               &access->data.open.stream_size);
+    case MPEGA_BSFUNC_CLOSE:
+        Close(file);
+        return 0;
+    case MPEGA_BSFUNC_READ: {
+        LONG got = Read(file, access->data.read.buffer, access->data.read.num_bytes);
+        return got > 0 ? (ULONG)got : 0;
+    }
+    case MPEGA_BSFUNC_SEEK: {
+        LONG pos = access->data.seek.abs_byte_seek_pos;
+        if (seekOverride >= 0) {
+            pos = seekOverride;
+            seekOverride = -1;
+        }
+        return Seek(file, pos, OFFSET_BEGINNING) == -1 ? 1 : 0;
+    }
+    }
+    return 0;
+}
+
+void initFileHook(struct Hook *hook) {
+    memset(hook, 0, sizeof(struct Hook));
+    hook->h_Entry = (HOOKFUNC)HookEntry;
+    hook->h_SubEntry = (HOOKFUNC)fileHookFunc;
+}
@@ -0,0 +1,15 @@
+#ifndef FILE_STREAM_H
+#define FILE_STREAM_H
+
+#include <exec/types.h>
+#include <utility/hooks.h>
+
+// Prepare a MPEGA_CTRL bs_access hook for local files. It behaves like the
+// library's own file access but lets the player redirect a seek.
+void initFileHook(struct Hook *hook);
+
+// Make the next MPEGA_BSFUNC_SEEK go to offset instead of the position
+// the library computed. -1 clears it.
+void setSeekOverride(LONG offset);
+
+#endif
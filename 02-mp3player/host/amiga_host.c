@@ -0,0 +1,499 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/stat.h>
+
+#include "amiga_host.h"
+
+// AvailMem() reports this much less what AllocMem() handed out
+#define HOST_MEMORY (256UL * 1024 * 1024)
+#define PROGDIR "PROGDIR:"
+#define NIL "NIL:"
+#define MAX_SPEC 32
+
+// 1978-01-01, the start of the AmigaDOS calendar, in Unix time
+#define AMIGA_EPOCH 252460800L
+
+#define IOERR_OPENFAIL -1
+
+static ULONG allocated = 0;
+static FILE *output = NULL;
+static LONG ioErr = 0;
+static struct Library library = {{NULL, NULL, 0, 0, "host"}, 45, 0};
+static struct Device timerDevice = {{{NULL, NULL, 0, 0, TIMERNAME}, 50, 0}};
+
+// Pending break signals, set from the signal handler
+static volatile sig_atomic_t breakC = 0;
+static volatile sig_atomic_t breakD = 0;
+
+static struct termios savedMode;
+static BOOL rawMode = FALSE;
+
+static void onSignal(int sig) {
+    if (sig == SIGINT) {
+        breakC = 1;
+    } else {
+        breakD = 1;
+    }
+}
+
+// Take a copy of stdout before the program gets to reopen it, and turn
+// the break keys into signals
+__attribute__((constructor)) static void openHost(void) {
+    int fd = dup(STDOUT_FILENO);
+    output = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (!output) output = stdout;
+
+    // Keys are read a byte at a time after WaitForChar()
+    setvbuf(stdin, NULL, _IONBF, 0);
+
+    // No SA_RESTART, so a break interrupts select()
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = onSignal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGQUIT, &action, NULL);
+}
+
+APTR AllocMem(ULONG size, ULONG requirements) {
+    APTR memory = requirements & MEMF_CLEAR ? calloc(1, size) : malloc(size);
+    if (memory) allocated += size;
+    return memory;
+}
+
+void FreeMem(APTR memory, ULONG size) {
+    free(memory);
+    allocated -= size;
+}
+
+APTR AllocVec(ULONG size, ULONG requirements) {
+    return requirements & MEMF_CLEAR ? calloc(1, size) : malloc(size);
+}
+
+void FreeVec(APTR memory) {
+    free(memory);
+}
+
+ULONG AvailMem(ULONG requirements) {
+    (void)requirements;
+    return allocated < HOST_MEMORY ? HOST_MEMORY - allocated : 0;
+}
+
+void CopyMem(const void *source, APTR dest, ULONG size) {
+    memmove(dest, source, size);
+}
+
+struct Library *OpenLibrary(CONST_STRPTR name, ULONG version) {
+    (void)name;
+    return version <= library.lib_Version ? &library : NULL;
+}
+
+void CloseLibrary(struct Library *base) {
+    (void)base;
+}
+
+struct MsgPort *CreateMsgPort(void) {
+    return calloc(1, sizeof(struct MsgPort));
+}
+
+void DeleteMsgPort(struct MsgPort *port) {
+    free(port);
+}
+
+struct IORequest *CreateIORequest(struct MsgPort *port, ULONG size) {
+    struct IORequest *request = port ? calloc(1, size) : NULL;
+    if (request) request->io_Message.mn_ReplyPort = port;
+    return request;
+}
+
+void DeleteIORequest(struct IORequest *request) {
+    free(request);
+}
+
+BYTE OpenDevice(CONST_STRPTR name, ULONG unit, struct IORequest *request, ULONG flags) {
+    (void)unit;
+    (void)flags;
+    if (strcmp(name, TIMERNAME) != 0) {
+        request->io_Error = IOERR_OPENFAIL;
+        return IOERR_OPENFAIL;
+    }
+
+    request->io_Device = &timerDevice;
+    request->io_Error = 0;
+    return 0;
+}
+
+void CloseDevice(struct IORequest *request) {
+    request->io_Device = NULL;
+}
+
+// Only timer.device opens, and nothing queues requests on it, so every
+// request is done as soon as it is sent
+void SendIO(struct IORequest *request) {
+    request->io_Error = 0;
+}
+
+BYTE WaitIO(struct IORequest *request) {
+    return request->io_Error;
+}
+
+void AbortIO(struct IORequest *request) {
+    (void)request;
+}
+
+struct IORequest *CheckIO(struct IORequest *request) {
+    return request;
+}
+
+static ULONG pendingSignals(void) {
+    return (breakC ? SIGBREAKF_CTRL_C : 0) | (breakD ? SIGBREAKF_CTRL_D : 0);
+}
+
+ULONG SetSignal(ULONG newSignals, ULONG mask) {
+    ULONG old = pendingSignals();
+
+    if (mask & SIGBREAKF_CTRL_C) breakC = (newSignals & SIGBREAKF_CTRL_C) != 0;
+    if (mask & SIGBREAKF_CTRL_D) breakD = (newSignals & SIGBREAKF_CTRL_D) != 0;
+    return old;
+}
+
+// Only the break signals ever arrive
+ULONG Wait(ULONG signals) {
+    sigset_t blocked, old;
+    ULONG received;
+
+    sigemptyset(&blocked);
+    sigaddset(&blocked, SIGINT);
+    sigaddset(&blocked, SIGQUIT);
+    sigprocmask(SIG_BLOCK, &blocked, &old);
+
+    while (!(received = pendingSignals() & signals)) {
+        sigsuspend(&old);
+    }
+    SetSignal(0, received);
+
+    sigprocmask(SIG_SETMASK, &old, NULL);
+    return received;
+}
+
+static const char *hostName(CONST_STRPTR name) {
+    if (strcmp(name, NIL) == 0) return NIL_FILE;
+    return strncmp(name, PROGDIR, strlen(PROGDIR)) == 0 ? name + strlen(PROGDIR) : name;
+}
+
+BPTR Open(CONST_STRPTR name, LONG mode) {
+    const char *path = hostName(name);
+    FILE *file = NULL;
+
+    switch (mode) {
+    case MODE_OLDFILE:
+        file = fopen(path, "rb");
+        break;
+    case MODE_NEWFILE:
+        file = fopen(path, "w+b");
+        break;
+    case MODE_READWRITE:
+        file = fopen(path, "r+b");
+        if (!file) file = fopen(path, "w+b");
+        break;
+    }
+
+    if (!file) ioErr = errno == ENOENT ? ERROR_OBJECT_NOT_FOUND : ERROR_WRITE_PROTECTED;
+    return (BPTR)file;
+}
+
+BOOL Close(BPTR file) {
+    return fclose((FILE *)file) == 0;
+}
+
+LONG Read(BPTR file, APTR buffer, LONG length) {
+    size_t got = fread(buffer, 1, length, (FILE *)file);
+    return got == 0 && ferror((FILE *)file) ? -1 : (LONG)got;
+}
+
+LONG Write(BPTR file, const void *buffer, LONG length) {
+    size_t put = fwrite(buffer, 1, length, (FILE *)file);
+    return put == 0 && length > 0 ? -1 : (LONG)put;
+}
+
+// Like dos.library, returns the position before the seek
+LONG Seek(BPTR file, LONG position, LONG mode) {
+    FILE *f = (FILE *)file;
+    int whence = mode == OFFSET_BEGINNING ? SEEK_SET : mode == OFFSET_END ? SEEK_END : SEEK_CUR;
+
+    LONG previous = ftell(f);
+    if (previous < 0 || fseek(f, position, whence) != 0) {
+        ioErr = ERROR_SEEK_ERROR;
+        return -1;
+    }
+    return previous;
+}
+
+STRPTR FGets(BPTR file, STRPTR buffer, ULONG length) {
+    return fgets(buffer, length, (FILE *)file);
+}
+
+BOOL DeleteFile(CONST_STRPTR name) {
+    return remove(hostName(name)) == 0;
+}
+
+// dos.library will not replace an existing file
+BOOL Rename(CONST_STRPTR from, CONST_STRPTR to) {
+    struct stat st;
+    if (stat(hostName(to), &st) == 0) return FALSE;
+    return rename(hostName(from), hostName(to)) == 0;
+}
+
+static void toDateStamp(struct DateStamp *date, time_t seconds, long nanoseconds) {
+    LONG amiga = (LONG)seconds - AMIGA_EPOCH;
+    date->ds_Days = amiga / 86400;
+    date->ds_Minute = amiga % 86400 / 60;
+    date->ds_Tick = amiga % 60 * TICKS_PER_SECOND + nanoseconds / (1000000000L / TICKS_PER_SECOND);
+}
+
+BOOL ExamineFH(BPTR file, struct FileInfoBlock *fib) {
+    struct stat st;
+    if (fstat(fileno((FILE *)file), &st) != 0) return FALSE;
+
+    memset(fib, 0, sizeof(*fib));
+    fib->fib_DirEntryType = S_ISDIR(st.st_mode) ? 2 : -3;
+    fib->fib_Size = st.st_size;
+    toDateStamp(&fib->fib_Date, st.st_mtim.tv_sec, st.st_mtim.tv_nsec);
+    return TRUE;
+}
+
+APTR AllocDosObject(ULONG type, const void *tags) {
+    (void)tags;
+    return type == DOS_FIB ? calloc(1, sizeof(struct FileInfoBlock)) : NULL;
+}
+
+void FreeDosObject(ULONG type, APTR object) {
+    (void)type;
+    free(object);
+}
+
+struct DateStamp *DateStamp(struct DateStamp *date) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    toDateStamp(date, now.tv_sec, now.tv_nsec);
+    return date;
+}
+
+// Negative when date1 is later, as in dos.library
+LONG CompareDates(const struct DateStamp *date1, const struct DateStamp *date2) {
+    if (date1->ds_Days != date2->ds_Days) return date2->ds_Days - date1->ds_Days;
+    if (date1->ds_Minute != date2->ds_Minute) return date2->ds_Minute - date1->ds_Minute;
+    return date2->ds_Tick - date1->ds_Tick;
+}
+
+// The separator before the last component, or where the name starts
+STRPTR PathPart(STRPTR path) {
+    char *slash = strrchr(path, '/');
+    char *colon = strrchr(path, ':');
+
+    if (slash) return slash;
+    return colon ? colon + 1 : path;
+}
+
+BOOL AddPart(STRPTR dir, CONST_STRPTR file, ULONG size) {
+    size_t length = strlen(dir);
+
+    if (file[0] == '/' || strchr(file, ':')) {
+        length = 0;
+    } else if (length && dir[length - 1] != '/' && dir[length - 1] != ':') {
+        if (length + 1 >= size) return FALSE;
+        dir[length++] = '/';
+    }
+    if (length + strlen(file) >= size) return FALSE;
+
+    strcpy(dir + length, file);
+    return TRUE;
+}
+
+LONG IoErr(void) {
+    return ioErr;
+}
+
+LONG SetIoErr(LONG code) {
+    LONG old = ioErr;
+    ioErr = code;
+    return old;
+}
+
+BOOL Fault(LONG code, CONST_STRPTR header, STRPTR buffer, LONG length) {
+    const char *message;
+
+    switch (code) {
+    case ERROR_NO_FREE_STORE:
+        message = "not enough memory available";
+        break;
+    case ERROR_OBJECT_NOT_FOUND:
+        message = "object not found";
+        break;
+    case ERROR_WRITE_PROTECTED:
+        message = "disk is write-protected";
+        break;
+    case ERROR_SEEK_ERROR:
+        message = "seek error";
+        break;
+    case ERROR_BREAK:
+        message = "***Break";
+        break;
+    default:
+        message = "unknown error";
+        break;
+    }
+
+    if (header) {
+        snprintf(buffer, length, "%s: %s", header, message);
+    } else {
+        snprintf(buffer, length, "%s", message);
+    }
+    return TRUE;
+}
+
+BPTR Input(void) {
+    return (BPTR)stdin;
+}
+
+BOOL IsInteractive(BPTR file) {
+    return isatty(fileno((FILE *)file));
+}
+
+// Raw mode: keys arrive one at a time and are not echoed
+BOOL SetMode(BPTR file, LONG mode) {
+    int fd = fileno((FILE *)file);
+
+    if (mode) {
+        struct termios raw;
+        if (rawMode || tcgetattr(fd, &savedMode) != 0) return rawMode;
+
+        raw = savedMode;
+        raw.c_lflag &= ~(ICANON | ECHO);
+        raw.c_cc[VMIN] = 1;
+        raw.c_cc[VTIME] = 0;
+        rawMode = tcsetattr(fd, TCSANOW, &raw) == 0;
+        return rawMode;
+    }
+
+    if (rawMode) {
+        tcsetattr(fd, TCSANOW, &savedMode);
+        rawMode = FALSE;
+    }
+    return TRUE;
+}
+
+BOOL WaitForChar(BPTR file, LONG micros) {
+    int fd = fileno((FILE *)file);
+    fd_set fds;
+    struct timeval timeout = {micros / 1000000, micros % 1000000};
+
+    FD_ZERO(&fds);
+    FD_SET(fd, &fds);
+    return select(fd + 1, &fds, NULL, NULL, &timeout) > 0;
+}
+
+// RawDoFmt style: every argument takes one LONG, %s gets a pointer
+LONG VPrintf(CONST_STRPTR format, const LONG *args) {
+    char spec[MAX_SPEC];
+    LONG count = 0;
+
+    for (const char *p = format; *p; p++) {
+        if (*p != '%') {
+            fputc(*p, output);
+            count++;
+            continue;
+        }
+        if (p[1] == '%') {
+            fputc('%', output);
+            count++;
+            p++;
+            continue;
+        }
+
+        // Flags, width and precision are kept, the length modifier is not
+        size_t length = 0;
+        spec[length++] = *p++;
+        while (*p && strchr("-+ #0123456789.", *p) && length < MAX_SPEC - 3) spec[length++] = *p++;
+        while (*p == 'l') p++;
+        if (!*p) break;
+
+        int written;
+        if (*p == 's') {
+            spec[length++] = 's';
+            spec[length] = '\0';
+            written = fprintf(output, spec, (const char *)*args++);
+        } else if (*p == 'c') {
+            spec[length++] = 'c';
+            spec[length] = '\0';
+            written = fprintf(output, spec, (int)*args++);
+        } else {
+            spec[length++] = 'l';
+            spec[length++] = *p;
+            spec[length] = '\0';
+            written = strchr("di", *p) ? fprintf(output, spec, *args++)
+                                       : fprintf(output, spec, (ULONG)*args++);
+        }
+        if (written > 0) count += written;
+    }
+
+    fflush(output);
+    return count;
+}
+
+LONG PutStr(CONST_STRPTR string) {
+    fputs(string, output);
+    fflush(output);
+    return 0;
+}
+
+// A microsecond E-clock
+ULONG ReadEClock(struct EClockVal *time) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    unsigned long long ticks = (unsigned long long)now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+    time->ev_hi = (ULONG)(ticks >> 32);
+    time->ev_lo = (ULONG)(ticks & 0xFFFFFFFFUL);
+    return 1000000;
+}
+
+LONG CloseSocket(LONG socket) {
+    return close(socket);
+}
+
+// select() that also returns, with 0, on the signals asked for. Like
+// bsdsocket.library, *signals holds the ones that arrived, if any.
+LONG WaitSelect(LONG count, fd_set *read, fd_set *write, fd_set *except,
+                struct timeval *timeout, ULONG *signals) {
+    ULONG mask = signals ? *signals : 0;
+
+    if (signals) *signals = 0;
+    if (pendingSignals() & mask) {
+        *signals = SetSignal(0, mask) & mask;
+        return 0;
+    }
+
+    LONG ready = select(count, read, write, except, timeout);
+    if (ready < 0 && errno == EINTR && (pendingSignals() & mask)) {
+        *signals = SetSignal(0, mask) & mask;
+        return 0;
+    }
+    return ready;
+}
+
+// The register shuffling HookEntry does on the Amiga is a plain call here
+ULONG HookEntry(struct Hook *hook, APTR object, APTR message) {
+    return hook->h_SubEntry(hook, object, message);
+}
+
+ULONG CallHookPkt(struct Hook *hook, APTR object, APTR message) {
+    return hook->h_Entry(hook, object, message);
+}
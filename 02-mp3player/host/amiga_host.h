@@ -0,0 +1,258 @@
+#ifndef AMIGA_HOST_H
+#define AMIGA_HOST_H
+
+// The exec, dos, timer.device, bsdsocket and amiga.lib calls the player
+// makes, on top of the C library, so mp3player, tunebench and
+// resamplebench also run on the development machine (see the "host"
+// target in the Makefile). The headers next to this one stand in for the
+// NDK ones and include it; mpega.library comes from fake_mpega.c.
+//
+// LONG and ULONG are the host's long, wide enough for the pointers the
+// code passes to VPrintf() and through hooks.
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/time.h>
+#include <sys/select.h>
+
+typedef int8_t BYTE;
+typedef uint8_t UBYTE;
+typedef int16_t WORD;
+typedef uint16_t UWORD;
+typedef long LONG;
+typedef unsigned long ULONG;
+typedef short BOOL;
+typedef void *APTR;
+typedef char *STRPTR;
+typedef const char *CONST_STRPTR;
+typedef long BPTR;
+
+#define TRUE 1
+#define FALSE 0
+
+// Register loading for hook functions, nothing to do here
+#define __saveds
+
+// exec/nodes.h, exec/ports.h, exec/libraries.h, exec/io.h
+struct Node {
+    struct Node *ln_Succ;
+    struct Node *ln_Pred;
+    UBYTE ln_Type;
+    BYTE ln_Pri;
+    char *ln_Name;
+};
+
+struct MinNode {
+    struct MinNode *mln_Succ;
+    struct MinNode *mln_Pred;
+};
+
+struct Library {
+    struct Node lib_Node;
+    UWORD lib_Version;
+    UWORD lib_Revision;
+};
+
+struct MsgPort {
+    struct Node mp_Node;
+    UBYTE mp_Flags;
+    UBYTE mp_SigBit;
+    APTR mp_SigTask;
+};
+
+struct Message {
+    struct Node mn_Node;
+    struct MsgPort *mn_ReplyPort;
+    UWORD mn_Length;
+};
+
+struct Device {
+    struct Library dd_Library;
+};
+
+struct IORequest {
+    struct Message io_Message;
+    struct Device *io_Device;
+    APTR io_Unit;
+    UWORD io_Command;
+    UBYTE io_Flags;
+    BYTE io_Error;
+};
+
+struct IOStdReq {
+    struct Message io_Message;
+    struct Device *io_Device;
+    APTR io_Unit;
+    UWORD io_Command;
+    UBYTE io_Flags;
+    BYTE io_Error;
+    ULONG io_Actual;
+    ULONG io_Length;
+    APTR io_Data;
+    ULONG io_Offset;
+};
+
+#define CMD_WRITE 3
+
+// exec/memory.h. The attributes only matter for MEMF_CLEAR here.
+#define MEMF_ANY    0L
+#define MEMF_PUBLIC (1L << 0)
+#define MEMF_CHIP   (1L << 1)
+#define MEMF_FAST   (1L << 2)
+#define MEMF_CLEAR  (1L << 16)
+
+// dos/dos.h, dos/dosextens.h
+#define MODE_OLDFILE   1005
+#define MODE_NEWFILE   1006
+#define MODE_READWRITE 1004
+
+#define OFFSET_BEGINNING -1
+#define OFFSET_CURRENT   0
+#define OFFSET_END       1
+
+#define TICKS_PER_SECOND 50
+
+#define RETURN_OK    0
+#define RETURN_WARN  5
+#define RETURN_ERROR 10
+#define RETURN_FAIL  20
+
+#define SIGBREAKF_CTRL_C (1L << 12)
+#define SIGBREAKF_CTRL_D (1L << 13)
+
+#define ERROR_NO_FREE_STORE    103
+#define ERROR_OBJECT_NOT_FOUND 205
+#define ERROR_WRITE_PROTECTED  214
+#define ERROR_SEEK_ERROR       219
+#define ERROR_BREAK            304
+
+#define DOS_FIB 2
+
+struct DateStamp {
+    LONG ds_Days;
+    LONG ds_Minute;
+    LONG ds_Tick;
+};
+
+struct FileInfoBlock {
+    LONG fib_DirEntryType;
+    char fib_FileName[108];
+    LONG fib_Size;
+    struct DateStamp fib_Date;
+};
+
+// devices/timer.h
+#define TIMERNAME "timer.device"
+#define UNIT_ECLOCK 2
+
+struct EClockVal {
+    ULONG ev_hi;
+    ULONG ev_lo;
+};
+
+struct timerequest {
+    struct IORequest tr_node;
+    struct timeval tr_time;
+};
+
+// devices/ahi.h. There is no ahi.device here, OpenDevice() refuses it.
+#define AHINAME "ahi.device"
+#define AHIST_M16S 1
+#define AHIST_S16S 3
+
+struct AHIRequest {
+    struct IOStdReq ahir_Std;
+    UWORD ahir_Version;
+    UWORD ahir_Pad1;
+    ULONG ahir_Private[2];
+    ULONG ahir_Type;
+    ULONG ahir_Frequency;
+    LONG ahir_Volume;
+    LONG ahir_Position;
+    struct AHIRequest *ahir_Link;
+};
+
+// utility/hooks.h
+struct Hook;
+
+typedef ULONG (*HOOKFUNC)(struct Hook *hook, APTR object, APTR message);
+
+struct Hook {
+    struct MinNode h_MinNode;
+    HOOKFUNC h_Entry;
+    HOOKFUNC h_SubEntry;
+    APTR h_Data;
+};
+
+// Where the benchmarks send output they do not look at
+#define NIL_FILE "/dev/null"
+
+// exec.library. Every OpenLibrary() succeeds, bsdsocket.library is the
+// C library's sockets and mpega.library is fake_mpega.c.
+APTR AllocMem(ULONG size, ULONG requirements);
+void FreeMem(APTR memory, ULONG size);
+APTR AllocVec(ULONG size, ULONG requirements);
+void FreeVec(APTR memory);
+ULONG AvailMem(ULONG requirements);
+void CopyMem(const void *source, APTR dest, ULONG size);
+struct Library *OpenLibrary(CONST_STRPTR name, ULONG version);
+void CloseLibrary(struct Library *library);
+struct MsgPort *CreateMsgPort(void);
+void DeleteMsgPort(struct MsgPort *port);
+struct IORequest *CreateIORequest(struct MsgPort *port, ULONG size);
+void DeleteIORequest(struct IORequest *request);
+BYTE OpenDevice(CONST_STRPTR name, ULONG unit, struct IORequest *request, ULONG flags);
+void CloseDevice(struct IORequest *request);
+void SendIO(struct IORequest *request);
+BYTE WaitIO(struct IORequest *request);
+void AbortIO(struct IORequest *request);
+struct IORequest *CheckIO(struct IORequest *request);
+
+// SIGINT arrives as CTRL-C, SIGQUIT as CTRL-D
+ULONG SetSignal(ULONG newSignals, ULONG mask);
+ULONG Wait(ULONG signals);
+
+// dos.library. Names starting with PROGDIR: are taken from the current
+// directory.
+BPTR Open(CONST_STRPTR name, LONG mode);
+BOOL Close(BPTR file);
+LONG Read(BPTR file, APTR buffer, LONG length);
+LONG Write(BPTR file, const void *buffer, LONG length);
+LONG Seek(BPTR file, LONG position, LONG mode);
+STRPTR FGets(BPTR file, STRPTR buffer, ULONG length);
+BOOL DeleteFile(CONST_STRPTR name);
+BOOL Rename(CONST_STRPTR from, CONST_STRPTR to);
+BOOL ExamineFH(BPTR file, struct FileInfoBlock *fib);
+APTR AllocDosObject(ULONG type, const void *tags);
+void FreeDosObject(ULONG type, APTR object);
+struct DateStamp *DateStamp(struct DateStamp *date);
+LONG CompareDates(const struct DateStamp *date1, const struct DateStamp *date2);
+STRPTR PathPart(STRPTR path);
+BOOL AddPart(STRPTR dir, CONST_STRPTR file, ULONG size);
+LONG IoErr(void);
+LONG SetIoErr(LONG code);
+BOOL Fault(LONG code, CONST_STRPTR header, STRPTR buffer, LONG length);
+
+// Input() is stdin; SetMode() puts a terminal into raw mode
+BPTR Input(void);
+BOOL IsInteractive(BPTR file);
+BOOL SetMode(BPTR file, LONG mode);
+BOOL WaitForChar(BPTR file, LONG micros);
+
+// Output() is the standard output the program started with, so it still
+// reaches the console after stdout has been reopened
+LONG VPrintf(CONST_STRPTR format, const LONG *args);
+LONG PutStr(CONST_STRPTR string);
+
+// timer.device
+ULONG ReadEClock(struct EClockVal *time);
+
+// bsdsocket.library, on top of the C library's sockets
+LONG CloseSocket(LONG socket);
+LONG WaitSelect(LONG count, fd_set *read, fd_set *write, fd_set *except,
+                struct timeval *timeout, ULONG *signals);
+
+// amiga.lib
+ULONG HookEntry(struct Hook *hook, APTR object, APTR message);
+ULONG CallHookPkt(struct Hook *hook, APTR object, APTR message);
+
+#endif
@@ -0,0 +1,194 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <clib/alib_protos.h>
+#include "libraries/mpega.h"
+#include "clib/mpega_protos.h"
+#include "fake_mpega.h"
+
+// mpega.library for the host build: decodes the stand-in stream described
+// in fake_mpega.h, through the bitstream hook like the real library, into
+// the PCM the frames name. Decoder settings are honoured the way the
+// player sees them: force_mono keeps channel 0, freq_div drops samples.
+struct FakeStream {
+    MPEGA_STREAM stream;    // First, MPEGA_STREAM * is a FakeStream *
+    struct Hook *hook;
+    APTR handle;
+    FILE *file;
+    ULONG nextFrame;
+    ULONG freqDiv;
+    LONG scale;
+};
+
+static ULONG getBE32(const UBYTE *p) {
+    return ((ULONG)p[0] << 24) | ((ULONG)p[1] << 16) | ((ULONG)p[2] << 8) | p[3];
+}
+
+static LONG readBytes(struct FakeStream *fs, UBYTE *buffer, LONG length) {
+    LONG got = 0;
+
+    while (got < length) {
+        LONG n;
+        if (fs->hook) {
+            MPEGA_ACCESS access;
+            access.func = MPEGA_BSFUNC_READ;
+            access.data.read.buffer = buffer + got;
+            access.data.read.num_bytes = length - got;
+            n = (LONG)CallHookPkt(fs->hook, fs->handle, &access);
+        } else {
+            n = (LONG)fread(buffer + got, 1, length - got, fs->file);
+        }
+        if (n <= 0) break;
+        got += n;
+    }
+    return got;
+}
+
+static BOOL seekBytes(struct FakeStream *fs, LONG position) {
+    if (fs->hook) {
+        MPEGA_ACCESS access;
+        access.func = MPEGA_BSFUNC_SEEK;
+        access.data.seek.abs_byte_seek_pos = position;
+        return CallHookPkt(fs->hook, fs->handle, &access) == 0;
+    }
+    return fseek(fs->file, position, SEEK_SET) == 0;
+}
+
+// The next whole frame, skipping bytes until a frame header lines up
+static BOOL readFrame(struct FakeStream *fs, UBYTE *frame) {
+    LONG got = readBytes(fs, frame, FAKE_FRAME_BYTES);
+
+    while (got == FAKE_FRAME_BYTES && getBE32(frame) != FAKE_HEADER) {
+        memmove(frame, frame + 1, FAKE_FRAME_BYTES - 1);
+        got = FAKE_FRAME_BYTES - 1 + readBytes(fs, frame + FAKE_FRAME_BYTES - 1, 1);
+    }
+    return got == FAKE_FRAME_BYTES;
+}
+
+MPEGA_STREAM *MPEGA_open(char *stream_name, MPEGA_CTRL *ctrl) {
+    struct FakeStream *fs = calloc(1, sizeof(struct FakeStream));
+    LONG size = 0;
+
+    if (!fs) return NULL;
+
+    fs->hook = ctrl->bs_access;
+    if (fs->hook) {
+        MPEGA_ACCESS access;
+        access.func = MPEGA_BSFUNC_OPEN;
+        access.data.open.stream_name = stream_name;
+        access.data.open.buffer_size = ctrl->stream_buffer_size;
+        access.data.open.stream_size = 0;
+        fs->handle = (APTR)CallHookPkt(fs->hook, NULL, &access);
+        size = access.data.open.stream_size;
+    } else {
+        fs->file = fopen(stream_name, "rb");
+        if (fs->file && fseek(fs->file, 0, SEEK_END) == 0) {
+            size = ftell(fs->file);
+            fseek(fs->file, 0, SEEK_SET);
+        }
+    }
+    if (!fs->handle && !fs->file) {
+        free(fs);
+        return NULL;
+    }
+
+    const MPEGA_LAYER *layer = &ctrl->layer_3;
+    const MPEGA_OUTPUT *output = layer->force_mono ? &layer->mono : &layer->stereo;
+
+    // freq_div 0 picks the largest rate up to freq_max
+    fs->freqDiv = output->freq_div;
+    if (fs->freqDiv == 0) {
+        fs->freqDiv = 1;
+        while (fs->freqDiv < 4 && output->freq_max &&
+               FAKE_FREQUENCY / fs->freqDiv > (ULONG)output->freq_max) {
+            fs->freqDiv *= 2;
+        }
+    }
+    fs->scale = 100;
+
+    MPEGA_STREAM *s = &fs->stream;
+    s->norm = 1;
+    s->layer = 3;
+    s->mode = MPEGA_MODE_STEREO;
+    s->bitrate = 128;
+    s->frequency = FAKE_FREQUENCY;
+    s->channels = FAKE_CHANNELS;
+    s->ms_duration = (ULONG)((unsigned long long)(size / FAKE_FRAME_BYTES) *
+                             FAKE_FRAME_SAMPLES * 1000 / FAKE_FREQUENCY);
+    s->dec_channels = layer->force_mono ? 1 : FAKE_CHANNELS;
+    s->dec_quality = output->quality;
+    s->dec_frequency = FAKE_FREQUENCY / fs->freqDiv;
+    return s;
+}
+
+void MPEGA_close(MPEGA_STREAM *mpds) {
+    struct FakeStream *fs = (struct FakeStream *)mpds;
+
+    if (fs->hook) {
+        MPEGA_ACCESS access;
+        access.func = MPEGA_BSFUNC_CLOSE;
+        CallHookPkt(fs->hook, fs->handle, &access);
+    } else {
+        fclose(fs->file);
+    }
+    free(fs);
+}
+
+LONG MPEGA_decode_frame(MPEGA_STREAM *mpds, WORD *pcm[MPEGA_MAX_CHANNELS]) {
+    struct FakeStream *fs = (struct FakeStream *)mpds;
+    UBYTE frame[FAKE_FRAME_BYTES];
+
+    if (!readFrame(fs, frame)) return MPEGA_ERR_EOF;
+
+    ULONG number = getBE32(frame + 4);
+    ULONG samples = FAKE_FRAME_SAMPLES / fs->freqDiv;
+
+    for (ULONG i = 0; i < samples; i++) {
+        ULONG position = number * FAKE_FRAME_SAMPLES + i * fs->freqDiv;
+        for (WORD c = 0; c < mpds->dec_channels; c++) {
+            WORD sample = FAKE_SAMPLE(position, c);
+            pcm[c][i] = fs->scale == 100 ? sample : (WORD)((LONG)sample * fs->scale / 100);
+        }
+    }
+
+    fs->nextFrame = number + 1;
+    return (LONG)samples;
+}
+
+LONG MPEGA_seek(MPEGA_STREAM *mpds, ULONG ms_time_position) {
+    struct FakeStream *fs = (struct FakeStream *)mpds;
+    ULONG frame = (ULONG)((unsigned long long)ms_time_position * FAKE_FREQUENCY /
+                          (FAKE_FRAME_SAMPLES * 1000ULL));
+
+    if (mpds->ms_duration && ms_time_position >= mpds->ms_duration) return MPEGA_ERR_EOF;
+    if (!seekBytes(fs, (LONG)(frame * FAKE_FRAME_BYTES))) return MPEGA_ERR_EOF;
+
+    fs->nextFrame = frame;
+    return MPEGA_ERR_NONE;
+}
+
+LONG MPEGA_time(MPEGA_STREAM *mpds, ULONG *ms_time_position) {
+    struct FakeStream *fs = (struct FakeStream *)mpds;
+
+    *ms_time_position = (ULONG)((unsigned long long)fs->nextFrame * FAKE_FRAME_SAMPLES * 1000 /
+                                FAKE_FREQUENCY);
+    return MPEGA_ERR_NONE;
+}
+
+LONG MPEGA_find_sync(BYTE *buffer, LONG buffer_size) {
+    const UBYTE *p = (const UBYTE *)buffer;
+
+    for (LONG i = 0; i + 1 < buffer_size; i++) {
+        if (p[i] == 0xff && (p[i + 1] & 0xe0) == 0xe0) return i;
+    }
+    return MPEGA_ERR_NO_SYNC;
+}
+
+LONG MPEGA_scale(MPEGA_STREAM *mpds, LONG scale_percent) {
+    if (scale_percent < 0) return MPEGA_ERR_BADVALUE;
+
+    ((struct FakeStream *)mpds)->scale = scale_percent;
+    return MPEGA_ERR_NONE;
+}
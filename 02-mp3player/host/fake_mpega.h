@@ -0,0 +1,21 @@
+#ifndef FAKE_MPEGA_H
+#define FAKE_MPEGA_H
+
+#include <exec/types.h>
+
+// The stand-in MP3 that fake_mpega.c decodes and fakestream writes and
+// checks: MPEG-1 layer III frames at 128 kbps, 44.1 kHz stereo, so the
+// seek index scan walks the same frames the decoder does. Each frame is
+// the header, the frame number big endian and zeros.
+#define FAKE_HEADER        0xFFFB9000UL
+#define FAKE_FRAME_BYTES   417
+#define FAKE_FRAME_SAMPLES 1152
+#define FAKE_FREQUENCY     44100
+#define FAKE_CHANNELS      2
+
+// Sample number position of the stream (FAKE_FRAME_SAMPLES per frame) on
+// channel, the PCM a run through the player has to reproduce
+#define FAKE_SAMPLE(position, channel) \
+    ((WORD)(((ULONG)(position) * 37 + (ULONG)(channel) * 16384) & 0xFFFF))
+
+#endif
@@ -0,0 +1,116 @@
+// Writes the stand-in MP3 fake_mpega.c decodes, and checks a WAV file
+// against the PCM it has to decode to. Used by "make check":
+//
+//   fakestream write <file> <frames>
+//   fakestream check <wav file> <frames> [first frame]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fake_mpega.h"
+
+#define WAV_HEADER_SIZE 44
+
+static void putBE32(UBYTE *p, ULONG v) {
+    p[0] = v >> 24;
+    p[1] = (v >> 16) & 0xff;
+    p[2] = (v >> 8) & 0xff;
+    p[3] = v & 0xff;
+}
+
+static ULONG getLE16(const UBYTE *p) {
+    return p[0] | ((ULONG)p[1] << 8);
+}
+
+static ULONG getLE32(const UBYTE *p) {
+    return getLE16(p) | (getLE16(p + 2) << 16);
+}
+
+static int writeStream(const char *filename, ULONG frames) {
+    UBYTE frame[FAKE_FRAME_BYTES];
+    FILE *file = fopen(filename, "wb");
+
+    if (!file) {
+        fprintf(stderr, "Unable to create %s\n", filename);
+        return EXIT_FAILURE;
+    }
+
+    memset(frame, 0, sizeof(frame));
+    putBE32(frame, FAKE_HEADER);
+    for (ULONG n = 0; n < frames; n++) {
+        putBE32(frame + 4, n);
+        if (fwrite(frame, 1, sizeof(frame), file) != sizeof(frame)) {
+            fprintf(stderr, "Unable to write %s\n", filename);
+            fclose(file);
+            return EXIT_FAILURE;
+        }
+    }
+
+    fclose(file);
+    return EXIT_SUCCESS;
+}
+
+static int checkWav(const char *filename, ULONG frames, ULONG first) {
+    UBYTE header[WAV_HEADER_SIZE];
+    UBYTE sample[2 * FAKE_CHANNELS];
+    FILE *file = fopen(filename, "rb");
+
+    if (!file) {
+        fprintf(stderr, "Unable to open %s\n", filename);
+        return EXIT_FAILURE;
+    }
+
+    ULONG expected = frames * FAKE_FRAME_SAMPLES;
+    if (fread(header, 1, sizeof(header), file) != sizeof(header) ||
+        memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVEfmt ", 8) != 0 ||
+        getLE16(header + 20) != 1 || getLE16(header + 22) != FAKE_CHANNELS ||
+        getLE32(header + 24) != FAKE_FREQUENCY || getLE16(header + 34) != 16 ||
+        memcmp(header + 36, "data", 4) != 0) {
+        fprintf(stderr, "%s: not 16-bit stereo PCM at %d Hz\n", filename, FAKE_FREQUENCY);
+        fclose(file);
+        return EXIT_FAILURE;
+    }
+    if (getLE32(header + 40) != expected * sizeof(sample)) {
+        fprintf(stderr, "%s: %lu data bytes, expected %lu\n", filename,
+                getLE32(header + 40), expected * (ULONG)sizeof(sample));
+        fclose(file);
+        return EXIT_FAILURE;
+    }
+
+    ULONG start = first * FAKE_FRAME_SAMPLES;
+    for (ULONG i = 0; i < expected; i++) {
+        if (fread(sample, 1, sizeof(sample), file) != sizeof(sample)) {
+            fprintf(stderr, "%s: ends at sample %lu\n", filename, i);
+            fclose(file);
+            return EXIT_FAILURE;
+        }
+        for (ULONG c = 0; c < FAKE_CHANNELS; c++) {
+            WORD got = (WORD)getLE16(sample + 2 * c);
+            WORD want = FAKE_SAMPLE(start + i, c);
+            if (got != want) {
+                fprintf(stderr, "%s: sample %lu channel %lu is %d, expected %d\n",
+                        filename, i, c, got, want);
+                fclose(file);
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    fclose(file);
+    printf("%s: %lu samples match\n", filename, expected);
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv) {
+    if (argc == 4 && strcmp(argv[1], "write") == 0) {
+        return writeStream(argv[2], strtoul(argv[3], NULL, 10));
+    }
+    if ((argc == 4 || argc == 5) && strcmp(argv[1], "check") == 0) {
+        return checkWav(argv[2], strtoul(argv[3], NULL, 10),
+                        argc == 5 ? strtoul(argv[4], NULL, 10) : 0);
+    }
+
+    fprintf(stderr, "Usage: %s write <file> <frames>\n"
+                    "       %s check <wav file> <frames> [first frame]\n", argv[0], argv[0]);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,441 @@
+#include <dos/dos.h>
+#include <exec/memory.h>
+#include <proto/exec.h>
+#include <proto/dos.h>
+#include <proto/bsdsocket.h>
+#include <clib/alib_protos.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "include/libraries/mpega.h"
+#include "http_stream.h"
+
+#define HTTP_TIMEOUT 15 // Seconds without data before the stream is dropped
+
+struct Library *SocketBase = NULL;
+static UWORD socketUsers = 0;
+
+struct HttpStream {
+    LONG socket;
+    UBYTE *ring;
+    ULONG ringRead;
+    ULONG ringWrite;
+    ULONG ringFill;
+    ULONG metaInt;      // icy-metaint, 0 if the server sends no metadata
+    ULONG metaLeft;     // Audio bytes until the next metadata block
+    ULONG metaLen;      // Metadata bytes still to collect
+    ULONG metaPos;
+    ULONG position;     // Audio bytes handed to the decoder
+    BOOL eof;
+    char meta[255 * 16 + 1];
+    char title[128];
+};
+
+static const char *NO_SOCKETS = "Unable to open bsdsocket.library\n";
+static const char *CONNECT_FAILED = "Unable to connect to %s\n";
+static const char *BAD_RESPONSE = "Server refused stream: %s\n";
+static const char *NOW_PLAYING = "Now playing: %s\n";
+static const char *REBUFFERING = "Rebuffering...\n";
+
+BOOL isHttpUrl(const char *name) {
+    return strncmp(name, "http://", 7) == 0;
+}
+
+static BOOL parseUrl(const char *url, char *host, ULONG hostSize, UWORD *port,
+                     char *path, ULONG pathSize) {
+    const char *p = url + 7;
+    ULONG len = 0;
+
+    while (*p && *p != ':' && *p != '/') {
+        if (len < hostSize - 1) host[len++] = *p;
+        p++;
+    }
+    host[len] = '\0';
+    if (len == 0) return FALSE;
+
+    *port = 80;
+    if (*p == ':') {
+        *port = (UWORD)atoi(++p);
+        while (*p && *p != '/') p++;
+    }
+
+    if (*p == '\0') p = "/";
+    strncpy(path, p, pathSize - 1);
+    path[pathSize - 1] = '\0';
+    return TRUE;
+}
+
+static LONG connectTo(const char *host, UWORD port) {
+    struct hostent *he = gethostbyname((STRPTR)host);
+    if (!he) return -1;
+
+    LONG s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s < 0) return -1;
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    memcpy(&addr.sin_addr, he->h_addr, he->h_length);
+
+    if (connect(s, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        CloseSocket(s);
+        return -1;
+    }
+    return s;
+}
+
+// Case-insensitive lookup of "name:" in the response headers
+static BOOL headerValue(const char *headers, const char *name, char *out, ULONG outSize) {
+    ULONG nameLen = strlen(name);
+    const char *line = headers;
+
+    while (*line) {
+        ULONG i = 0;
+        while (i < nameLen && line[i] &&
+               (line[i] | 0x20) == (name[i] | 0x20)) i++;
+
+        if (i == nameLen && line[i] == ':') {
+            const char *v = line + i + 1;
+            ULONG len = 0;
+            while (*v == ' ') v++;
+            while (v[len] && v[len] != '\r' && v[len] != '\n' && len < outSize - 1) {
+                out[len] = v[len];
+                len++;
+            }
+            out[len] = '\0';
+            return TRUE;
+        }
+
+        while (*line && *line != '\n') line++;
+        if (*line) line++;
+    }
+    return FALSE;
+}
+
+// Receive the response header block into area, recv()ing as much as has
+// arrived each time. On success the blank line ending the headers is
+// replaced by a NUL, *length is the size of the block and *received the
+// bytes read, which may run on into the stream.
+static BOOL readHeaders(LONG s, UBYTE *area, ULONG *length, ULONG *received) {
+    ULONG fill = 0;
+    ULONG scanned = 0;
+
+    while (fill < HTTP_HEADER_SIZE) {
+        LONG n = recv(s, area + fill, HTTP_HEADER_SIZE - fill, 0);
+        if (n <= 0) return FALSE;
+        fill += n;
+
+        // "\r\n\r\n", or "\n\n" from servers that skip the CR
+        for (; scanned < fill; scanned++) {
+            if (area[scanned] != '\n' || scanned == 0) continue;
+
+            if (area[scanned - 1] == '\n' ||
+                (scanned >= 2 && area[scanned - 1] == '\r' && area[scanned - 2] == '\n')) {
+                area[scanned] = '\0';
+                *length = scanned + 1;
+                *received = fill;
+                return TRUE;
+            }
+        }
+    }
+    return FALSE;
+}
+
+// Connect and issue the GET, following redirects. Returns the socket or -1.
+// The headers are left in area as a string, see readHeaders().
+static LONG requestStream(const char *url, UBYTE *area, ULONG *length, ULONG *received) {
+    const char *headers = (const char *)area;
+    char location[256];
+    char host[64];
+    char path[256];
+    char request[512];
+    UWORD port;
+
+    strncpy(location, url, sizeof(location) - 1);
+    location[sizeof(location) - 1] = '\0';
+
+    for (int redirects = 0; redirects <= HTTP_MAX_REDIRECT; redirects++) {
+        if (!isHttpUrl(location) ||
+            !parseUrl(location, host, sizeof(host), &port, path, sizeof(path))) {
+            return -1;
+        }
+
+        LONG s = connectTo(host, port);
+        if (s < 0) {
+            LONG args[] = {(LONG)host};
+            VPrintf((STRPTR)CONNECT_FAILED, (LONG *)args);
+            return -1;
+        }
+
+        strcpy(request, "GET ");
+        strcat(request, path);
+        strcat(request, " HTTP/1.0\r\nHost: ");
+        strcat(request, host);
+        strcat(request, "\r\nUser-Agent: mp3player\r\n"
+                        "Icy-MetaData: 1\r\n"
+                        "Connection: close\r\n\r\n");
+
+        if (send(s, request, strlen(request), 0) != (LONG)strlen(request) ||
+            !readHeaders(s, area, length, received)) {
+            CloseSocket(s);
+            return -1;
+        }
+
+        // "ICY 200 OK" from SHOUTcast, "HTTP/1.x 200 OK" from Icecast
+        const char *status = strchr(headers, ' ');
+        LONG code = status ? atoi(status + 1) : 0;
+
+        if (code == 200) return s;
+
+        CloseSocket(s);
+        if (code >= 301 && code <= 308 &&
+            headerValue(headers, "Location", location, sizeof(location))) {
+            continue;
+        }
+
+        char *eol = strpbrk((char *)area, "\r\n");
+        if (eol) *eol = '\0';
+        LONG args[] = {(LONG)headers};
+        VPrintf((STRPTR)BAD_RESPONSE, (LONG *)args);
+        return -1;
+    }
+    return -1;
+}
+
+static void ringPut(struct HttpStream *hs, const UBYTE *data, ULONG length) {
+    ULONG first = HTTP_JITTER_SIZE - hs->ringWrite;
+    if (first > length) first = length;
+
+    CopyMem((APTR)data, hs->ring + hs->ringWrite, first);
+    if (length > first) CopyMem((APTR)(data + first), hs->ring, length - first);
+
+    hs->ringWrite = (hs->ringWrite + length) % HTTP_JITTER_SIZE;
+    hs->ringFill += length;
+}
+
+static ULONG ringGet(struct HttpStream *hs, UBYTE *data, ULONG length) {
+    if (length > hs->ringFill) length = hs->ringFill;
+
+    ULONG first = HTTP_JITTER_SIZE - hs->ringRead;
+    if (first > length) first = length;
+
+    CopyMem(hs->ring + hs->ringRead, data, first);
+    if (length > first) CopyMem(hs->ring, data + first, length - first);
+
+    hs->ringRead = (hs->ringRead + length) % HTTP_JITTER_SIZE;
+    hs->ringFill -= length;
+    return length;
+}
+
+// Pick StreamTitle='...'; out of an ICY metadata block
+static void handleMetadata(struct HttpStream *hs) {
+    const char *start = strstr(hs->meta, "StreamTitle='");
+    if (!start) return;
+    start += 13;
+
+    const char *end = strstr(start, "';");
+    ULONG len = end ? (ULONG)(end - start) : strlen(start);
+    if (len > sizeof(hs->title) - 1) len = sizeof(hs->title) - 1;
+
+    if (strncmp(hs->title, start, len) == 0 && hs->title[len] == '\0') return;
+
+    CopyMem((APTR)start, hs->title, len);
+    hs->title[len] = '\0';
+
+    LONG args[] = {(LONG)hs->title};
+    VPrintf((STRPTR)NOW_PLAYING, (LONG *)args);
+}
+
+// Split received bytes into audio (into the ring) and ICY metadata
+static void demux(struct HttpStream *hs, const UBYTE *buf, ULONG length) {
+    ULONG i = 0;
+
+    while (i < length) {
+        if (hs->metaLen) {
+            ULONG take = length - i;
+            if (take > hs->metaLen) take = hs->metaLen;
+
+            CopyMem((APTR)(buf + i), hs->meta + hs->metaPos, take);
+            hs->metaPos += take;
+            hs->metaLen -= take;
+            i += take;
+
+            if (hs->metaLen == 0) {
+                hs->meta[hs->metaPos] = '\0';
+                handleMetadata(hs);
+                hs->metaLeft = hs->metaInt;
+            }
+        } else if (hs->metaInt && hs->metaLeft == 0) {
+            // Length byte, in units of 16 bytes
+            hs->metaLen = buf[i++] * 16;
+            hs->metaPos = 0;
+            if (hs->metaLen == 0) hs->metaLeft = hs->metaInt;
+        } else {
+            ULONG take = length - i;
+            if (hs->metaInt && take > hs->metaLeft) take = hs->metaLeft;
+
+            ringPut(hs, buf + i, take);
+            if (hs->metaInt) hs->metaLeft -= take;
+            i += take;
+        }
+    }
+}
+
+// Move data from the socket into the ring. When block is FALSE only data
+// that is already waiting is taken. Sets eof on end of stream, timeout,
+// error or CTRL-C.
+static void pumpSocket(struct HttpStream *hs, BOOL block) {
+    UBYTE buf[HTTP_RECV_SIZE];
+    ULONG space = HTTP_JITTER_SIZE - hs->ringFill;
+    if (space > sizeof(buf)) space = sizeof(buf);
+    if (space == 0 || hs->eof) return;
+
+    fd_set rfds;
+    struct timeval tv;
+    ULONG sigs = SIGBREAKF_CTRL_C;
+
+    FD_ZERO(&rfds);
+    FD_SET(hs->socket, &rfds);
+    tv.tv_sec = block ? HTTP_TIMEOUT : 0;
+    tv.tv_usec = 0;
+
+    LONG ready = WaitSelect(hs->socket + 1, &rfds, NULL, NULL, &tv, &sigs);
+    if (ready == 0) {
+        if (sigs & SIGBREAKF_CTRL_C) {
+            // Leave the break for the main loop to see
+            SetSignal(SIGBREAKF_CTRL_C, SIGBREAKF_CTRL_C);
+            hs->eof = TRUE;
+        } else if (block) {
+            hs->eof = TRUE;
+        }
+        return;
+    }
+    if (ready < 0) {
+        hs->eof = TRUE;
+        return;
+    }
+
+    LONG n = recv(hs->socket, buf, space, 0);
+    if (n <= 0) {
+        hs->eof = TRUE;
+        return;
+    }
+    demux(hs, buf, n);
+}
+
+static void prefill(struct HttpStream *hs) {
+    while (!hs->eof && hs->ringFill < HTTP_PREFILL_SIZE) {
+        pumpSocket(hs, TRUE);
+    }
+}
+
+static void closeStream(struct HttpStream *hs) {
+    if (hs->socket >= 0) CloseSocket(hs->socket);
+    if (hs->ring) FreeMem(hs->ring, HTTP_JITTER_SIZE);
+    FreeMem(hs, sizeof(struct HttpStream));
+
+    if (--socketUsers == 0) {
+        CloseLibrary(SocketBase);
+        SocketBase = NULL;
+    }
+}
+
+static struct HttpStream *openStream(const char *url, LONG *streamSize) {
+    if (!SocketBase) {
+        SocketBase = OpenLibrary("bsdsocket.library", 4);
+        if (!SocketBase) {
+            PutStr((STRPTR)NO_SOCKETS);
+            return NULL;
+        }
+    }
+    socketUsers++;
+
+    struct HttpStream *hs = AllocMem(sizeof(struct HttpStream), MEMF_ANY|MEMF_CLEAR);
+    if (!hs) {
+        if (--socketUsers == 0) {
+            CloseLibrary(SocketBase);
+            SocketBase = NULL;
+        }
+        return NULL;
+    }
+    hs->socket = -1;
+
+    hs->ring = AllocMem(HTTP_JITTER_SIZE, MEMF_ANY);
+    if (!hs->ring) {
+        closeStream(hs);
+        return NULL;
+    }
+
+    // The headers arrive at the top of the empty ring, clear of where
+    // demux() puts the stream bytes that came with them
+    UBYTE *area = hs->ring + HTTP_JITTER_SIZE - HTTP_HEADER_SIZE;
+    const char *headers = (const char *)area;
+    ULONG headerLength;
+    ULONG received;
+    char value[32];
+
+    hs->socket = requestStream(url, area, &headerLength, &received);
+    if (hs->socket < 0) {
+        closeStream(hs);
+        return NULL;
+    }
+
+    if (headerValue(headers, "icy-metaint", value, sizeof(value))) {
+        hs->metaInt = atol(value);
+        hs->metaLeft = hs->metaInt;
+    }
+
+    // Plain HTTP servers give a length, live streams do not
+    *streamSize = 0;
+    if (headerValue(headers, "Content-Length", value, sizeof(value))) {
+        *streamSize = atol(value);
+    }
+
+    demux(hs, area + headerLength, received - headerLength);
+    prefill(hs);
+    return hs;
+}
+
+static ULONG readStream(struct HttpStream *hs, UBYTE *buffer, ULONG length) {
+    // Top up the jitter buffer with whatever has arrived
+    pumpSocket(hs, FALSE);
+
+    if (hs->ringFill == 0 && !hs->eof) {
+        PutStr((STRPTR)REBUFFERING);
+        prefill(hs);
+    }
+
+    ULONG got = ringGet(hs, buffer, length);
+    hs->position += got;
+    return got;
+}
+
+static ULONG __saveds httpHookFunc(struct Hook *hook, APTR handle, MPEGA_ACCESS *access) {
+    struct HttpStream *hs = (struct HttpStream *)handle;
+    (void)hook;
+
+    switch (access->func) {
+    case MPEGA_BSFUNC_OPEN:
+        return (ULONG)openStream(access->data.open.stream_name,
+                                 &access->data.open.stream_size);
+    case MPEGA_BSFUNC_CLOSE:
+        closeStream(hs);
+        return 0;
+    case MPEGA_BSFUNC_READ:
+        return readStream(hs, access->data.read.buffer, access->data.read.num_bytes);
+    case MPEGA_BSFUNC_SEEK:
+        // Live streams only move forward, seekTrack() leaves them alone
+        return access->data.seek.abs_byte_seek_pos == (LONG)hs->position ? 0 : 1;
+    }
+    return 0;
+}
+
+void initHttpHook(struct Hook *hook) {
+    memset(hook, 0, sizeof(struct Hook));
+    hook->h_Entry = (HOOKFUNC)HookEntry;
+    hook->h_SubEntry = (HOOKFUNC)httpHookFunc;
+}
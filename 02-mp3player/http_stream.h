@@ -0,0 +1,22 @@
+#ifndef HTTP_STREAM_H
+#define HTTP_STREAM_H
+
+#include <exec/types.h>
+#include <utility/hooks.h>
+
+#define HTTP_JITTER_SIZE  65536 // Ring buffer between socket and decoder
+#define HTTP_PREFILL_SIZE 16384 // Audio bytes buffered before decoding starts
+#define HTTP_RECV_SIZE    4096  // Bytes pulled from the socket per recv()
+#define HTTP_HEADER_SIZE  2048  // Longest response header block, at most
+                                // half of HTTP_JITTER_SIZE
+#define HTTP_MAX_REDIRECT 3
+
+// Returns TRUE if name looks like an http:// URL
+BOOL isHttpUrl(const char *name);
+
+// Prepare a MPEGA_CTRL bs_access hook reading Icecast/SHOUTcast streams.
+// The stream name passed to MPEGA_open() is the URL. The streams only move
+// forward, so the player does not seek them.
+void initHttpHook(struct Hook *hook);
+
+#endif
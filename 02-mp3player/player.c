@@ -1,274 +1,779 @@
-#include <devices/ahi.h>
 #include <dos/dos.h>
 #include <exec/memory.h>
 #include <proto/exec.h>
 #include <proto/dos.h>
-#include <proto/ahi.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "include/libraries/mpega.h"
 #include "include/clib/mpega_protos.h"
+#include "http_stream.h"
+#include "audio_sink.h"
+#include "player_stats.h"
+#include "timer_util.h"
+#include "playlist.h"
+#include "file_stream.h"
+#include "seek_index.h"
+#include "replaygain.h"
+#include "resample.h"
+#include "buffer_pool.h"
 
-#define BUFFER_SIZE 32768
 #define MP3_CHUNK_SIZE 4096
 #define FREQUENCY 44100
-#define TYPE AHIST_M16S
-
-// AHI structures
-struct MsgPort *AHImp = NULL;
-struct AHIRequest *AHIios[2] = {NULL, NULL};
-struct AHIRequest *AHIio = NULL;
-APTR AHIiocopy = NULL;
-BYTE AHIDevice = -1;
+#define MAX_FRAMES 16   // MPEG frames per output buffer
+#define MIN_RATE 8000   // Lowest MPEG 2.5 rate
+#define MAX_FREQ_DIV 4  // Largest divisor adaptive mode decodes with
+#define ERROR_SIZE 256
+
+// Adaptive decoding: give up quality, then output rate, when decoding
+// takes more than ADAPT_LOAD percent of the playing time it produces
+#define ADAPT_WINDOW 32 // frames per measurement
+#define ADAPT_LOAD 85
+
+// Gapless playlists: open the next track this long before the current one
+// ends and decode up to PRIME_FRAMES frames to get its first samples ready
+#define PREOPEN_MS 3000
+#define PRIME_FRAMES 8
+
+// Interactive skip distance
+#define SKIP_MS 10000
+
+// Command line options
+struct PlayerOptions {
+    const char *sinkName;
+    const char *outFile;
+    UWORD frames;       // MPEG frames per output buffer
+    WORD quality;       // MPEGA_QUALITY_xxx to start with
+    ULONG startMs;      // Resume position in the first track
+    BOOL stats;
+    BOOL adaptive;
+    LONG gain;          // Hundredths of a dB, on top of ReplayGain
+    BOOL replayGain;
+    LONG rate;          // Fixed output rate, 0 plays at the decoded rate
+    WORD resampleQuality;
+    BOOL fastPcm;       // Decode buffers in fast RAM
+    BOOL chipOutput;    // Output buffers in chip RAM for DMA
+};
+
+struct PlayerOptions opts = {"ahi", "out.wav", 1, MPEGA_QUALITY_HIGH, 0, FALSE, FALSE, 0, FALSE,
+                             0, RESAMPLE_MEDIUM, FALSE, FALSE};
+
+// Files and URLs to play, in order
+struct Playlist playlist;
+ULONG currentTrack = 0;
+ULONG nextTrack = 0;
+
+// Current decoder settings, lowered by adaptive mode
+WORD decodeQuality = MPEGA_QUALITY_HIGH;
+WORD decodeFreqDiv = 1;
+
+// Decode load over the current adaptive window
+struct {
+    UWORD frames;
+    ULONG decodeUs;
+    unsigned long long audioUs;
+} adapt;
+
+// Output
+struct AudioSink *sink = NULL;
 
 // MPEGA structures
 struct Library *MPEGABase = NULL;
 MPEGA_STREAM *mpegaStream = NULL;
 WORD *pcmBuffers[MPEGA_MAX_CHANNELS];
-
-// Audio buffers
+struct Hook httpHook;
+struct Hook fileHook;
+
+// Seek table of the current track, built on its first seek
+struct SeekIndex seekIndex;
+BOOL seekIndexTried = FALSE;
+BOOL skipTrack = FALSE;
+BOOL interactive = FALSE;
+
+// Next track, opened ahead with its first frame already decoded
+MPEGA_STREAM *nextStream = NULL;
+WORD *nextPcmBuffers[MPEGA_MAX_CHANNELS];
+LONG primedSamples = 0; // Samples in pcmBuffers not yet interleaved
+
+// Converts the decoded rate to opts.rate
+struct Resampler resampler;
+
+// Q12 gain factors applied while interleaving
+WORD trackGain = GAIN_UNITY;
+WORD nextGain = GAIN_UNITY;
+
+// Audio buffers, carved from decodePool or outputPool when the two need
+// different memory
+struct BufferPool decodePool;
+struct BufferPool outputPool;
 WORD *buffer1 = NULL;
 WORD *buffer2 = NULL;
+ULONG outputSize = 0; // WORDs per output buffer
 UBYTE *errorBuffer = NULL;
 
-static const char *UNABLE_TO_OPEN = "Unable to open %s/0 version 4\n";
-static const char *USAGE = "Usage: %s <mp3file>\n";
-static const char *FAILED_TO_INIT = "Failed to initialize AHI\n";
+static const char *USAGE = "Usage: %s [-sink ahi|null|wav] [-o <wavfile>] [-frames <n>] [-stats]\n"
+                            "          [-quality 0-2] [-adaptive] [-start <seconds>]\n"
+                            "          [-gain <dB>] [-replaygain] [-rate <hz>] [-resample 0-2]\n"
+                            "          [-fastpcm] [-chipout]\n"
+                            "          <mp3file|m3ufile|http://host:port/mount>...\n"
+                            "Keys while playing: f/b skip 10s forward/back, n next track\n"
+                            "CTRL-D prints statistics while playing with -stats\n";
+static const char *BAD_PLAYLIST = "Unable to read playlist %s\n";
+static const char *CANNOT_OPEN = "Unable to play %s\n";
+static const char *FORMAT_MISMATCH = "Skipping %s: %ld Hz/%ld channels does not match output\n";
+static const char *NOW_PLAYING = "Track %ld/%ld: %s\n";
+static const char *POSITION = "Position %ld:%02ld\n";
+static const char *FAILED_TO_INIT = "Failed to initialize %s output\n";
 static const char *NO_MEMORY = "Not enough memory\n";
 static const char *MPEGA_FAILED = "Failed to initialize MPEGA library\n";
+static const char *NO_TIMER = "Unable to open timer.device\n";
+static const char *ADAPTING = "Decoder load %ld%%, switching to quality %ld at %ld Hz\n";
 
 void cleanup(LONG rc) {
-    if (!AHIDevice) {
-        CloseDevice((struct IORequest *)AHIio);
-    }
-    if (AHIio) {
-        DeleteIORequest((struct IORequest *)AHIio);
-    }
-    if (AHIiocopy) {
-        FreeMem(AHIiocopy, sizeof(struct AHIRequest));
-    }
-    if (AHImp) {
-        DeleteMsgPort(AHImp);
-    }
-    if (buffer1) {
-        FreeMem(buffer1, BUFFER_SIZE * sizeof(WORD));
+    if (interactive) {
+        SetMode(Input(), 0);
     }
-    if (buffer2) {
-        FreeMem(buffer2, BUFFER_SIZE * sizeof(WORD));
+    if (sink) {
+        sink->close(sink);
     }
-    if (errorBuffer) {
-        FreeMem(errorBuffer, 256);
+    statsClose();
+    if (opts.adaptive) {
+        timerClose();
     }
 
     // Cleanup MPEGA
     if (mpegaStream) {
         MPEGA_close(mpegaStream);
     }
+    if (nextStream) {
+        MPEGA_close(nextStream);
+    }
     if (MPEGABase) {
         CloseLibrary(MPEGABase);
     }
 
-    // Free PCM buffers
-    for (int i = 0; i < MPEGA_MAX_CHANNELS; i++) {
-        if (pcmBuffers[i]) {
-            FreeMem(pcmBuffers[i], MPEGA_PCM_SIZE * sizeof(WORD));
-        }
-    }
+    // Free PCM and output buffers
+    poolDelete(&outputPool);
+    poolDelete(&decodePool);
+
+    playlistFree(&playlist);
+    seekIndexFree(&seekIndex);
+    resamplerFree(&resampler);
 
     exit(rc);
 }
 
-BOOL allocateBuffers(void) {
-    buffer1 = AllocMem(BUFFER_SIZE * sizeof(WORD), MEMF_ANY|MEMF_CLEAR);
-    if (!buffer1) return FALSE;
-
-    buffer2 = AllocMem(BUFFER_SIZE * sizeof(WORD), MEMF_ANY|MEMF_CLEAR);
-    if (!buffer2) return FALSE;
-
-    errorBuffer = AllocMem(256, MEMF_ANY|MEMF_CLEAR);
-    if (!errorBuffer) return FALSE;
-
-    // Allocate PCM buffers for MPEGA
-    for (int i = 0; i < MPEGA_MAX_CHANNELS; i++) {
-        pcmBuffers[i] = AllocMem(MPEGA_PCM_SIZE * sizeof(WORD), MEMF_ANY|MEMF_CLEAR);
-        if (!pcmBuffers[i]) return FALSE;
+BOOL parseArgs(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-sink") == 0 && i + 1 < argc) {
+            opts.sinkName = argv[++i];
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            opts.outFile = argv[++i];
+        } else if (strcmp(argv[i], "-frames") == 0 && i + 1 < argc) {
+            LONG frames = atol(argv[++i]);
+            if (frames < 1 || frames > MAX_FRAMES) return FALSE;
+            opts.frames = (UWORD)frames;
+        } else if (strcmp(argv[i], "-quality") == 0 && i + 1 < argc) {
+            opts.quality = (WORD)atoi(argv[++i]);
+            if (opts.quality < MPEGA_QUALITY_LOW || opts.quality > MPEGA_QUALITY_HIGH) return FALSE;
+        } else if (strcmp(argv[i], "-start") == 0 && i + 1 < argc) {
+            opts.startMs = atol(argv[++i]) * 1000;
+        } else if (strcmp(argv[i], "-stats") == 0) {
+            opts.stats = TRUE;
+        } else if (strcmp(argv[i], "-adaptive") == 0) {
+            opts.adaptive = TRUE;
+        } else if (strcmp(argv[i], "-gain") == 0 && i + 1 < argc) {
+            opts.gain = parseGain(argv[++i]);
+        } else if (strcmp(argv[i], "-replaygain") == 0) {
+            opts.replayGain = TRUE;
+        } else if (strcmp(argv[i], "-rate") == 0 && i + 1 < argc) {
+            opts.rate = atol(argv[++i]);
+            if (opts.rate < 8000 || opts.rate > 96000) return FALSE;
+        } else if (strcmp(argv[i], "-resample") == 0 && i + 1 < argc) {
+            opts.resampleQuality = (WORD)atoi(argv[++i]);
+            if (opts.resampleQuality < RESAMPLE_FAST || opts.resampleQuality > RESAMPLE_HIGH) return FALSE;
+        } else if (strcmp(argv[i], "-fastpcm") == 0) {
+            opts.fastPcm = TRUE;
+        } else if (strcmp(argv[i], "-chipout") == 0) {
+            opts.chipOutput = TRUE;
+        } else if (argv[i][0] == '-') {
+            return FALSE;
+        } else if (isM3U(argv[i])) {
+            if (!playlistAddM3U(&playlist, argv[i])) {
+                LONG args[] = {(LONG)argv[i]};
+                VPrintf((STRPTR)BAD_PLAYLIST, (LONG *)args);
+                return FALSE;
+            }
+        } else if (!playlistAdd(&playlist, argv[i])) {
+            return FALSE;
+        }
     }
 
-    return TRUE;
+    sink = findSink(opts.sinkName);
+    return playlist.count && sink;
 }
 
-BOOL initMPEGA(const char *filename) {
-    MPEGABase = OpenLibrary("mpega.library", 0);
-    if (!MPEGABase) return FALSE;
-
+MPEGA_STREAM *openStream(const char *filename) {
     // Setup MPEGA control structure
     MPEGA_CTRL ctrl = {
-        NULL,    // Default file access
+        NULL,    // Default file access, replaced below for streams
         // Layers I & II settings
-        { FALSE, { 1, 2, FREQUENCY }, { 1, 2, FREQUENCY } },
+        { FALSE, { decodeFreqDiv, decodeQuality, FREQUENCY },
+                 { decodeFreqDiv, decodeQuality, FREQUENCY } },
         // Layer III settings
-        { FALSE, { 1, 2, FREQUENCY }, { 1, 2, FREQUENCY } },
+        { FALSE, { decodeFreqDiv, decodeQuality, FREQUENCY },
+                 { decodeFreqDiv, decodeQuality, FREQUENCY } },
         0,      // Don't check MPEG validity
         32768   // Stream buffer size
     };
 
+    // Radio streams are read through the HTTP bitstream hook, files
+    // through ours so seeks can use the seek table
+    if (isHttpUrl(filename)) {
+        initHttpHook(&httpHook);
+        ctrl.bs_access = &httpHook;
+    } else {
+        initFileHook(&fileHook);
+        ctrl.bs_access = &fileHook;
+    }
+
+    return MPEGA_open((char *)filename, &ctrl);
+}
+
+// Open the first playable track from *track on, skipping the ones that
+// fail. NULL once the playlist is exhausted.
+MPEGA_STREAM *openTrack(ULONG *track) {
+    while (*track < playlist.count) {
+        MPEGA_STREAM *stream = openStream(playlist.names[*track]);
+        if (stream) return stream;
+
+        LONG args[] = {(LONG)playlist.names[*track]};
+        VPrintf((STRPTR)CANNOT_OPEN, (LONG *)args);
+        (*track)++;
+    }
+    return NULL;
+}
+
+// Gain factor for a track: -gain plus its ReplayGain tag if asked for.
+// Streams carry no tags.
+WORD gainFor(const char *name) {
+    LONG centiDb = opts.gain;
+    LONG tagGain;
+
+    if (opts.replayGain && !isHttpUrl(name) && readReplayGain(name, &tagGain)) {
+        centiDb += tagGain;
+    }
+    return gainFactor(centiDb);
+}
+
+void announceTrack(void) {
+    if (playlist.count < 2) return;
+
+    LONG args[] = {(LONG)(currentTrack + 1), (LONG)playlist.count,
+                   (LONG)playlist.names[currentTrack]};
+    VPrintf((STRPTR)NOW_PLAYING, (LONG *)args);
+}
+
+BOOL initMPEGA(void) {
+    MPEGABase = OpenLibrary("mpega.library", 0);
+    if (!MPEGABase) return FALSE;
+
     // Open MP3 stream
-    mpegaStream = MPEGA_open((char *)filename, &ctrl);
+    decodeQuality = opts.quality;
+    mpegaStream = openTrack(&currentTrack);
+    nextTrack = currentTrack + 1;
 
     if (!mpegaStream) {
         CloseLibrary(MPEGABase);
+        MPEGABase = NULL;
         return FALSE;
     }
 
+    trackGain = gainFor(playlist.names[currentTrack]);
     return TRUE;
 }
 
-BOOL initAHI(void) {
-    AHImp = CreateMsgPort();
-    if (!AHImp) return FALSE;
+// Rate the sink plays at for a stream
+LONG outputRate(const MPEGA_STREAM *stream) {
+    return opts.rate ? opts.rate : stream->dec_frequency;
+}
 
-    AHIio = (struct AHIRequest *)CreateIORequest(AHImp, sizeof(struct AHIRequest));
-    if (!AHIio) {
-        DeleteMsgPort(AHImp);
-        return FALSE;
+// Match the converter to the current stream. It is left alone when
+// nothing changed so gapless switches keep its buffered input.
+BOOL setupResampler(void) {
+    LONG rate = outputRate(mpegaStream);
+
+    if (resampler.inRate == mpegaStream->dec_frequency && resampler.outRate == rate &&
+        resampler.channels == mpegaStream->dec_channels) return TRUE;
+
+    return resamplerInit(&resampler, mpegaStream->dec_frequency, rate,
+                         mpegaStream->dec_channels, opts.resampleQuality, MPEGA_PCM_SIZE);
+}
+
+// Room one decoded frame may take in an output buffer
+ULONG frameSpace(void) {
+    return resamplerMaxOutput(&resampler, MPEGA_PCM_SIZE) * mpegaStream->dec_channels;
+}
+
+// Output buffers hold opts.frames frames of the first track. Playlists
+// may switch to stereo or a lower decoded rate later, and adaptive mode
+// divides the rate by up to MAX_FREQ_DIV. Both raise the resampling ratio,
+// so they get room for at least one frame at the lowest rate they reach.
+ULONG outputBufferSize(void) {
+    ULONG size = opts.frames * frameSpace();
+    BOOL playlistMode = playlist.count > 1;
+
+    if (!playlistMode && !opts.adaptive) return size;
+
+    LONG lowest = playlistMode ? MIN_RATE : mpegaStream->dec_frequency;
+    if (opts.adaptive) lowest /= MAX_FREQ_DIV;
+
+    ULONG worst = MPEGA_PCM_SIZE;
+    if (opts.rate) worst = worst * opts.rate / lowest + 2;
+    worst *= playlistMode ? MPEGA_MAX_CHANNELS : mpegaStream->dec_channels;
+
+    if (size < worst) size = worst;
+    return size;
+}
+
+// Allocate all buffers from one pool sized for the opened stream. Only
+// playlists need a second set of PCM buffers to prime the next track.
+BOOL allocateBuffers(void) {
+    if (!setupResampler()) return FALSE;
+
+    BOOL priming = playlist.count > 1;
+    WORD channels = priming ? MPEGA_MAX_CHANNELS : mpegaStream->dec_channels;
+    ULONG pcmBytes = MPEGA_PCM_SIZE * sizeof(WORD);
+    ULONG decodeBytes = (priming ? 2 : 1) * channels * POOL_BLOCK(pcmBytes) + POOL_BLOCK(ERROR_SIZE);
+
+    outputSize = outputBufferSize();
+    ULONG outputBytes = POOL_BLOCK(outputSize * sizeof(WORD));
+
+    ULONG decodeFlags = opts.fastPcm ? MEMF_PUBLIC|MEMF_FAST : MEMF_PUBLIC;
+    ULONG outputFlags = opts.chipOutput ? MEMF_PUBLIC|MEMF_CHIP : MEMF_PUBLIC;
+    struct BufferPool *output = &decodePool;
+
+    if (decodeFlags == outputFlags) {
+        decodeBytes += 2 * outputBytes;
+    } else {
+        if (!poolCreate(&outputPool, 2 * outputBytes, outputFlags)) return FALSE;
+        output = &outputPool;
     }
+    if (!poolCreate(&decodePool, decodeBytes, decodeFlags)) return FALSE;
 
-    AHIio->ahir_Version = 4;
-    AHIDevice = OpenDevice((STRPTR)AHINAME, 0, (struct IORequest *)AHIio, 0);
-    if (AHIDevice) {
-        LONG args[] = {(LONG)AHINAME};
-        VPrintf((STRPTR)UNABLE_TO_OPEN, (LONG *)args);
-        return FALSE;
+    buffer1 = poolTake(output, outputBytes);
+    buffer2 = poolTake(output, outputBytes);
+    errorBuffer = poolTake(&decodePool, ERROR_SIZE);
+
+    for (int ch = 0; ch < channels; ch++) {
+        pcmBuffers[ch] = poolTake(&decodePool, pcmBytes);
+        if (priming) nextPcmBuffers[ch] = poolTake(&decodePool, pcmBytes);
     }
 
-    AHIiocopy = AllocMem(sizeof(struct AHIRequest), MEMF_ANY);
-    if (!AHIiocopy) return FALSE;
-    
-    CopyMem(AHIio, AHIiocopy, sizeof(struct AHIRequest));
-    AHIios[0] = AHIio;
-    AHIios[1] = (struct AHIRequest *)AHIiocopy;
-    
     return TRUE;
 }
 
+BOOL initSink(void) {
+    if (!setupResampler()) return FALSE;
+
+    sink->frequency = outputRate(mpegaStream);
+    sink->channels = mpegaStream->dec_channels;
+    sink->buffers[0] = buffer1;
+    sink->buffers[1] = buffer2;
+    sink->bufferSize = outputSize;
+
+    return sink->open(sink, opts.outFile);
+}
+
+// Copy count decoded samples per channel from pcmBuffers into buffer.
+// The track gain is applied in the same pass, saturating at 16 bits.
+ULONG interleave(WORD *buffer, LONG count) {
+    WORD *dst = buffer;
+    WORD channels = mpegaStream->dec_channels;
+
+    if (resampler.coeffs) {
+        return resamplerProcess(&resampler, pcmBuffers, count, buffer, trackGain);
+    }
+
+    if (trackGain == GAIN_UNITY) {
+        for (int i = 0; i < count; i++) {
+            for (int ch = 0; ch < channels; ch++) {
+                *dst++ = pcmBuffers[ch][i];
+            }
+        }
+        return count * channels;
+    }
+
+    for (int i = 0; i < count; i++) {
+        for (int ch = 0; ch < channels; ch++) {
+            LONG sample = ((LONG)pcmBuffers[ch][i] * trackGain) >> GAIN_SHIFT;
+            if (sample > 32767) sample = 32767;
+            else if (sample < -32768) sample = -32768;
+            *dst++ = (WORD)sample;
+        }
+    }
+    return count * channels;
+}
+
 BOOL decodeMPEGAFrame(WORD *buffer, ULONG *length) {
-    LONG pcm_count = MPEGA_decode_frame(mpegaStream, pcmBuffers);
-    if (pcm_count <= 0) {
+    struct EClockVal start, end;
+
+    BOOL timing = stats.enabled || opts.adaptive;
+
+    if (skipTrack) {
+        skipTrack = FALSE;
         *length = 0;
         return FALSE;
     }
 
-    // Copy decoded PCM data to play buffer
-    WORD *dst = buffer;
-    for (int i = 0; i < pcm_count; i++) {
-        for (int ch = 0; ch < mpegaStream->dec_channels; ch++) {
-            *dst++ = pcmBuffers[ch][i];
-        }
+    if (timing) timerNow(&start);
+    LONG pcm_count = MPEGA_decode_frame(mpegaStream, pcmBuffers);
+    if (timing) {
+        timerNow(&end);
+
+        ULONG micros = timerMicros(&start, &end);
+        LONG samples = pcm_count > 0 ? pcm_count : 0;
+        if (stats.enabled) statsDecode(micros, samples, mpegaStream->dec_frequency);
+
+        adapt.frames++;
+        adapt.decodeUs += micros;
+        adapt.audioUs += (unsigned long long)samples * 1000000 / mpegaStream->dec_frequency;
     }
 
-    *length = pcm_count * mpegaStream->dec_channels;
+    // Skipped frames return 0 samples and are not the end of the stream
+    *length = 0;
+    if (pcm_count < 0) return FALSE;
+
+    *length = interleave(buffer, pcm_count);
     return TRUE;
 }
 
-BOOL playBuffer(WORD *buffer, ULONG length, struct AHIRequest *req, struct AHIRequest *link) {
-    req->ahir_Std.io_Message.mn_Node.ln_Pri = 0;
-    req->ahir_Std.io_Command = CMD_WRITE;
-    req->ahir_Std.io_Data = buffer;
-    req->ahir_Std.io_Length = length * sizeof(WORD);
-    req->ahir_Std.io_Offset = 0;
-    req->ahir_Frequency = FREQUENCY;
-    req->ahir_Type = TYPE;
-    req->ahir_Volume = 0x10000;
-    req->ahir_Position = 0x8000;
-    req->ahir_Link = link;
-    
-    SendIO((struct IORequest *)req);
+// Open and prime the next track. Tracks that fail, decode nothing or do
+// not fit a fixed-format sink are skipped.
+void prepareNextTrack(void) {
+    while (!nextStream && nextTrack < playlist.count) {
+        nextStream = openTrack(&nextTrack);
+        if (!nextStream) return;
+
+        const char *name = playlist.names[nextTrack];
+        BOOL fits = sink->variableRate ||
+                    (outputRate(nextStream) == sink->frequency &&
+                     nextStream->dec_channels == sink->channels);
+
+        if (!fits) {
+            LONG args[] = {(LONG)name, (LONG)nextStream->dec_frequency,
+                           (LONG)nextStream->dec_channels};
+            VPrintf((STRPTR)FORMAT_MISMATCH, (LONG *)args);
+        } else {
+            // Layer III may return empty frames before the first samples
+            LONG samples = 0;
+            for (int i = 0; i < PRIME_FRAMES && samples == 0; i++) {
+                samples = MPEGA_decode_frame(nextStream, nextPcmBuffers);
+            }
+            if (samples > 0) {
+                primedSamples = samples;
+                nextGain = gainFor(name);
+                return;
+            }
+
+            LONG args[] = {(LONG)name};
+            VPrintf((STRPTR)CANNOT_OPEN, (LONG *)args);
+        }
+
+        MPEGA_close(nextStream);
+        nextStream = NULL;
+        nextTrack++;
+    }
+}
+
+// Make the prepared track current. Its primed samples are left in
+// pcmBuffers for the caller to emit.
+BOOL switchTrack(void) {
+    // Unknown durations (live streams) are opened only now
+    prepareNextTrack();
+    if (!nextStream) return FALSE;
+
+    MPEGA_close(mpegaStream);
+    mpegaStream = nextStream;
+    nextStream = NULL;
+    currentTrack = nextTrack++;
+    trackGain = nextGain;
+
+    seekIndexFree(&seekIndex);
+    seekIndexTried = FALSE;
+
+    for (int ch = 0; ch < MPEGA_MAX_CHANNELS; ch++) {
+        WORD *tmp = pcmBuffers[ch];
+        pcmBuffers[ch] = nextPcmBuffers[ch];
+        nextPcmBuffers[ch] = tmp;
+    }
+
+    announceTrack();
+    return setupResampler();
+}
+
+// Pre-open the next track once the current one is about to end
+void checkNextTrack(void) {
+    ULONG position;
+
+    if (nextStream || nextTrack >= playlist.count) return;
+    if (mpegaStream->ms_duration == 0) return;
+    if (MPEGA_time(mpegaStream, &position)) return;
+
+    if (position + PREOPEN_MS >= mpegaStream->ms_duration) {
+        prepareNextTrack();
+    }
+}
+
+// What fillBuffer() left in the buffer
+enum FillResult {
+    FILL_END,       // Playlist finished, nothing decoded
+    FILL_AUDIO,     // length samples to submit
+    FILL_SWITCHED   // Empty: the next track needs a new buffer for its format
+};
+
+// Decode opts.frames non-empty frames into buffer, fewer when upsampling
+// would overflow it or the next track has another format.
+enum FillResult fillBuffer(WORD *buffer, ULONG *length) {
+    ULONG frameLength;
+    UWORD frames = 0;
+    BOOL switched = FALSE;
+
+    *length = 0;
+
+    // First samples of a track that started at a buffer boundary
+    if (primedSamples) {
+        sink->frequency = outputRate(mpegaStream);
+        sink->channels = mpegaStream->dec_channels;
+        *length = interleave(buffer, primedSamples);
+        primedSamples = 0;
+        frames++;
+    }
+
+    while (frames < opts.frames && *length + frameSpace() <= sink->bufferSize) {
+        if (!decodeMPEGAFrame(buffer + *length, &frameLength)) {
+            // End of track: carry on with the next one without a gap
+            if (!switchTrack()) break;
+
+            // A format change has to start a new buffer
+            if (outputRate(mpegaStream) != sink->frequency ||
+                mpegaStream->dec_channels != sink->channels) {
+                switched = TRUE;
+                break;
+            }
+
+            frameLength = interleave(buffer + *length, primedSamples);
+            primedSamples = 0;
+        }
+        if (frameLength) frames++;
+        *length += frameLength;
+    }
+
+    if (*length) return FILL_AUDIO;
+    return switched ? FILL_SWITCHED : FILL_END;
+}
+
+// Radio streams only move forward, so the HTTP hook refuses any seek
+BOOL trackSeekable(void) {
+    return !isHttpUrl(playlist.names[currentTrack]);
+}
+
+// Move the current track to ms. The seek table gives the byte offset and
+// the file hook makes MPEGA_seek use it instead of searching. Tracks that
+// cannot seek are left where they are.
+BOOL seekTrack(ULONG ms) {
+    const char *name = playlist.names[currentTrack];
+    if (!trackSeekable()) return FALSE;
+
+    if (!seekIndexTried) {
+        seekIndexTried = TRUE;
+        seekIndexOpen(&seekIndex, name);
+    }
+
+    setSeekOverride(seekIndexLookup(&seekIndex, &ms));
+    LONG rc = MPEGA_seek(mpegaStream, ms);
+    setSeekOverride(-1);
+
+    resamplerReset(&resampler);
+
+    return rc == 0;
+}
+
+void seekRelative(LONG deltaMs) {
+    ULONG position;
+
+    if (!trackSeekable() || MPEGA_time(mpegaStream, &position)) return;
+
+    LONG target = (LONG)position + deltaMs;
+    if (target < 0) target = 0;
+
+    if (mpegaStream->ms_duration && (ULONG)target >= mpegaStream->ms_duration) {
+        skipTrack = TRUE;
+        return;
+    }
+
+    if (seekTrack(target) && MPEGA_time(mpegaStream, &position) == 0) {
+        LONG args[] = {(LONG)(position / 60000), (LONG)(position / 1000 % 60)};
+        VPrintf((STRPTR)POSITION, (LONG *)args);
+    }
+}
+
+// Poll the console for playback keys
+void handleKeys(void) {
+    BPTR in = Input();
+    UBYTE c;
+
+    while (WaitForChar(in, 0) && Read(in, &c, 1) == 1) {
+        switch (c) {
+        case 'f':
+            seekRelative(SKIP_MS);
+            break;
+        case 'b':
+            seekRelative(-SKIP_MS);
+            break;
+        case 'n':
+            skipTrack = TRUE;
+            break;
+        case 3: // CTRL-C arrives as a character in raw mode
+            SetSignal(SIGBREAKF_CTRL_C, SIGBREAKF_CTRL_C);
+            break;
+        }
+    }
+}
+
+// Reopen the stream with the current decoder settings and continue from
+// the same position. Live streams simply reconnect.
+BOOL reopenStream(void) {
+    ULONG position = 0;
+
+    const char *name = playlist.names[currentTrack];
+
+    if (trackSeekable()) {
+        MPEGA_time(mpegaStream, &position);
+    }
+
+    MPEGA_close(mpegaStream);
+    mpegaStream = openStream(name);
+    if (!mpegaStream) return FALSE;
+
+    if (position) {
+        seekTrack(position);
+    }
+
+    // Only sinks with variableRate see a change here, the others get
+    // the new rate converted
+    sink->frequency = outputRate(mpegaStream);
+    return setupResampler();
+}
+
+// Called between buffers: step the decoder down when it cannot keep up
+BOOL adaptDecoder(void) {
+    if (adapt.frames < ADAPT_WINDOW) return TRUE;
+
+    ULONG load = adapt.audioUs ? (ULONG)(adapt.decodeUs * 100ULL / adapt.audioUs) : 0;
+    memset(&adapt, 0, sizeof(adapt));
+
+    if (load < ADAPT_LOAD) return TRUE;
+
+    if (decodeQuality > MPEGA_QUALITY_LOW) {
+        decodeQuality--;
+    } else if (decodeFreqDiv < MAX_FREQ_DIV && (sink->variableRate || opts.rate)) {
+        decodeFreqDiv *= 2;
+    } else {
+        return TRUE; // Nothing left to give up
+    }
+
+    if (!reopenStream()) return FALSE;
+
+    LONG args[] = {(LONG)load, (LONG)mpegaStream->dec_quality, (LONG)mpegaStream->dec_frequency};
+    VPrintf((STRPTR)ADAPTING, (LONG *)args);
     return TRUE;
 }
 
 int main(int argc, char **argv) {
-    if (argc != 2) {
+    if (!parseArgs(argc, argv)) {
         LONG args[] = {(LONG)argv[0]};
         VPrintf((STRPTR)USAGE, (LONG *)args);
         return RETURN_FAIL;
     }
 
+    if (!initMPEGA()) {
+        PutStr((STRPTR)MPEGA_FAILED);
+        cleanup(RETURN_FAIL);
+        return RETURN_FAIL;
+    }
+
+    // Sized from the stream, so only now
     if (!allocateBuffers()) {
         PutStr((STRPTR)NO_MEMORY);
+        cleanup(RETURN_FAIL);
         return RETURN_FAIL;
     }
 
-    if (!initMPEGA(argv[1])) {
-        PutStr((STRPTR)MPEGA_FAILED);
+    if ((opts.stats && !statsOpen()) || (opts.adaptive && !timerOpen())) {
+        PutStr((STRPTR)NO_TIMER);
         cleanup(RETURN_FAIL);
         return RETURN_FAIL;
     }
 
-    if (!initAHI()) {
-        PutStr((STRPTR)FAILED_TO_INIT);
+    if (!initSink()) {
+        LONG args[] = {(LONG)sink->name};
+        VPrintf((STRPTR)FAILED_TO_INIT, (LONG *)args);
         cleanup(RETURN_FAIL);
         return RETURN_FAIL;
     }
 
-    WORD *p1 = buffer1;
-    WORD *p2 = buffer2;
-    void *tmp;
-    struct AHIRequest *link = NULL;
-    ULONG signals, length;
+    ULONG length;
+
+    announceTrack();
+
+    if (opts.startMs && trackSeekable()) {
+        seekTrack(opts.startMs);
+    }
+
+    // Raw console mode so keys arrive without RETURN
+    interactive = IsInteractive(Input()) && SetMode(Input(), 1);
 
     // Main playback loop
     SetIoErr(0);
     for(;;) {
-        // Decode MP3 frame
-        if (!decodeMPEGAFrame(p1, &length)) break;
+        WORD *buffer = sink->getBuffer(sink);
 
-        // Play buffer
-        if (!playBuffer(p1, length, AHIios[0], link)) break;
+        // Decode MP3 frames. The primed samples of a track in another
+        // format go out in the next buffer.
+        enum FillResult fill = fillBuffer(buffer, &length);
+        if (fill == FILL_END) break;
+        if (fill == FILL_SWITCHED) continue;
 
-        if (link) {
-            signals = Wait(SIGBREAKF_CTRL_C | (1L << AHImp->mp_SigBit));
-            
-            if (signals & SIGBREAKF_CTRL_C) {
-                SetIoErr(ERROR_BREAK);
-                break;
-            }
+        // Play buffer
+        if (!sink->submit(sink, buffer, length)) break;
 
-            if (WaitIO((struct IORequest *)link)) {
-                SetIoErr(ERROR_WRITE_PROTECTED);
-                break;
-            }
+        if (stats.enabled && (SetSignal(0, SIGBREAKF_CTRL_D) & SIGBREAKF_CTRL_D)) {
+            statsDump();
         }
 
-        if (length == 0) {
-            WaitIO((struct IORequest *)AHIios[0]);
+        if (opts.adaptive && !adaptDecoder()) {
+            PutStr((STRPTR)MPEGA_FAILED);
             break;
         }
 
-        link = AHIios[0];
+        checkNextTrack();
 
-        // Swap buffers and requests
-        tmp = p1;
-        p1 = p2;
-        p2 = tmp;
-        tmp = AHIios[0];
-        AHIios[0] = AHIios[1];
-        AHIios[1] = tmp;
+        if (interactive) {
+            handleKeys();
+        }
     }
 
-    // Cleanup
-    AbortIO((struct IORequest *)AHIios[0]);
-    WaitIO((struct IORequest *)AHIios[0]);
-    
-    if (link) {
-        AbortIO((struct IORequest *)AHIios[1]);
-        WaitIO((struct IORequest *)AHIios[1]);
-    }
+    statsDump();
 
     if (IoErr()) {
-        Fault(IoErr(), (STRPTR)argv[0], (STRPTR)errorBuffer, 256);
+        Fault(IoErr(), (STRPTR)argv[0], (STRPTR)errorBuffer, ERROR_SIZE);
         cleanup(RETURN_ERROR);
     }
 
+    // Let the queued audio finish before closing the output
+    sink->drain(sink);
+
     cleanup(RETURN_OK);
     return RETURN_OK;
-}
\ No newline at end of file
+}
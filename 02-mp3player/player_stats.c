@@ -0,0 +1,108 @@
+#include <dos/dos.h>
+#include <proto/exec.h>
+#include <proto/dos.h>
+#include <string.h>
+
+#include "player_stats.h"
+#include "timer_util.h"
+
+struct PlayerStats stats;
+
+static const char *STATS_HEADER = "\n--- Playback statistics ---\n";
+static const char *STATS_DECODE = "Frames decoded:  %ld (%ld ms audio in %ld ms decode, max %ld us)\n";
+static const char *STATS_FACTOR = "Realtime factor: %ld.%02ld x decode, %ld.%02ld x wall clock\n";
+static const char *STATS_BUCKET = "  < %4ld ms: %ld\n";
+static const char *STATS_BUCKET_LAST = "  >=%4ld ms: %ld\n";
+static const char *STATS_WAIT = "Blocked in Wait: %ld ms\n";
+static const char *STATS_FILL = "Queue fill:      min %ld ms, avg %ld ms, max %ld ms over %ld submits\n";
+static const char *STATS_UNDERRUN = "Underruns:       %ld\n";
+
+BOOL statsOpen(void) {
+    memset(&stats, 0, sizeof(stats));
+    if (!timerOpen()) return FALSE;
+
+    stats.enabled = TRUE;
+    stats.fillMinMs = 0x7fffffff;
+    timerNow(&stats.start);
+    return TRUE;
+}
+
+void statsClose(void) {
+    if (!stats.enabled) return;
+
+    stats.enabled = FALSE;
+    timerClose();
+}
+
+void statsDecode(ULONG micros, LONG samples, LONG frequency) {
+    UWORD bucket = 0;
+    while (bucket < STATS_BUCKETS - 1 && micros >= (1000UL << bucket)) bucket++;
+
+    stats.decodeHist[bucket]++;
+    stats.frames++;
+    stats.audioUs += (unsigned long long)samples * 1000000 / frequency;
+    stats.decodeUs += micros;
+    if (micros > stats.decodeMaxUs) stats.decodeMaxUs = micros;
+}
+
+void statsWait(ULONG micros) {
+    stats.waitUs += micros;
+}
+
+void statsSubmit(LONG fillMs, BOOL underrun) {
+    stats.submits++;
+    if (underrun) stats.underruns++;
+
+    if (fillMs < stats.fillMinMs) stats.fillMinMs = fillMs;
+    if (fillMs > stats.fillMaxMs) stats.fillMaxMs = fillMs;
+    stats.fillSumMs += fillMs;
+}
+
+// Factor in hundredths, guarding against empty runs
+static ULONG ratio(ULONG num, ULONG den) {
+    return den ? (ULONG)((unsigned long long)num * 100 / den) : 0;
+}
+
+void statsDump(void) {
+    if (!stats.enabled) return;
+
+    struct EClockVal now;
+    timerNow(&now);
+
+    ULONG wallMs = timerMillis(&stats.start, &now);
+    ULONG audioMs = (ULONG)(stats.audioUs / 1000);
+    ULONG decodeMs = (ULONG)(stats.decodeUs / 1000);
+    ULONG decodeFactor = ratio(audioMs, decodeMs);
+    ULONG wallFactor = ratio(audioMs, wallMs);
+
+    PutStr((STRPTR)STATS_HEADER);
+
+    LONG decodeArgs[] = {(LONG)stats.frames, (LONG)audioMs, (LONG)decodeMs, (LONG)stats.decodeMaxUs};
+    VPrintf((STRPTR)STATS_DECODE, (LONG *)decodeArgs);
+
+    LONG factorArgs[] = {(LONG)(decodeFactor / 100), (LONG)(decodeFactor % 100),
+                         (LONG)(wallFactor / 100), (LONG)(wallFactor % 100)};
+    VPrintf((STRPTR)STATS_FACTOR, (LONG *)factorArgs);
+
+    for (UWORD i = 0; i < STATS_BUCKETS; i++) {
+        if (i < STATS_BUCKETS - 1) {
+            LONG args[] = {(LONG)(1L << i), (LONG)stats.decodeHist[i]};
+            VPrintf((STRPTR)STATS_BUCKET, (LONG *)args);
+        } else {
+            LONG args[] = {(LONG)(1L << (i - 1)), (LONG)stats.decodeHist[i]};
+            VPrintf((STRPTR)STATS_BUCKET_LAST, (LONG *)args);
+        }
+    }
+
+    LONG waitArgs[] = {(LONG)(stats.waitUs / 1000)};
+    VPrintf((STRPTR)STATS_WAIT, (LONG *)waitArgs);
+
+    if (stats.submits) {
+        LONG fillArgs[] = {stats.fillMinMs, (LONG)(stats.fillSumMs / stats.submits),
+                           stats.fillMaxMs, (LONG)stats.submits};
+        VPrintf((STRPTR)STATS_FILL, (LONG *)fillArgs);
+    }
+
+    LONG underrunArgs[] = {(LONG)stats.underruns};
+    VPrintf((STRPTR)STATS_UNDERRUN, (LONG *)underrunArgs);
+}
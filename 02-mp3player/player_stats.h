@@ -0,0 +1,38 @@
+#ifndef PLAYER_STATS_H
+#define PLAYER_STATS_H
+
+#include <exec/types.h>
+#include <devices/timer.h>
+
+// Decode time histogram: bucket i counts frames under (1 << i) ms,
+// the last bucket everything slower
+#define STATS_BUCKETS 9
+
+struct PlayerStats {
+    BOOL enabled;
+    struct EClockVal start;
+
+    ULONG frames;               // MPEG frames decoded
+    unsigned long long audioUs; // Duration of the decoded audio
+    unsigned long long decodeUs; // Total time inside MPEGA_decode_frame
+    ULONG decodeMaxUs;
+    ULONG decodeHist[STATS_BUCKETS];
+
+    unsigned long long waitUs;  // Time blocked in Wait/WaitIO
+    ULONG submits;
+    ULONG underruns;            // Queue ran dry before the next submit
+    LONG fillMinMs;             // Audio queued ahead at each submit
+    LONG fillMaxMs;
+    unsigned long long fillSumMs;
+};
+
+extern struct PlayerStats stats;
+
+BOOL statsOpen(void);
+void statsClose(void);
+void statsDecode(ULONG micros, LONG samples, LONG frequency);
+void statsWait(ULONG micros);
+void statsSubmit(LONG fillMs, BOOL underrun);
+void statsDump(void);
+
+#endif
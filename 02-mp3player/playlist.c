@@ -0,0 +1,81 @@
+#include <dos/dos.h>
+#include <exec/memory.h>
+#include <proto/exec.h>
+#include <proto/dos.h>
+#include <string.h>
+
+#include "playlist.h"
+
+#define M3U_LINE_SIZE 256
+
+BOOL isM3U(const char *name) {
+    ULONG len = strlen(name);
+    if (len < 4) return FALSE;
+
+    const char *ext = name + len - 4;
+    return ext[0] == '.' && (ext[1] | 0x20) == 'm' && ext[2] == '3' && (ext[3] | 0x20) == 'u';
+}
+
+BOOL playlistAdd(struct Playlist *pl, const char *name) {
+    if (pl->count == pl->capacity) {
+        ULONG capacity = pl->capacity ? pl->capacity * 2 : 16;
+        STRPTR *names = AllocVec(capacity * sizeof(STRPTR), MEMF_ANY|MEMF_CLEAR);
+        if (!names) return FALSE;
+
+        if (pl->names) {
+            CopyMem(pl->names, names, pl->count * sizeof(STRPTR));
+            FreeVec(pl->names);
+        }
+        pl->names = names;
+        pl->capacity = capacity;
+    }
+
+    STRPTR copy = AllocVec(strlen(name) + 1, MEMF_ANY);
+    if (!copy) return FALSE;
+
+    strcpy(copy, name);
+    pl->names[pl->count++] = copy;
+    return TRUE;
+}
+
+BOOL playlistAddM3U(struct Playlist *pl, const char *filename) {
+    char line[M3U_LINE_SIZE];
+    char path[M3U_LINE_SIZE];
+    BOOL ok = TRUE;
+
+    BPTR file = Open((CONST_STRPTR)filename, MODE_OLDFILE);
+    if (!file) return FALSE;
+
+    // Directory of the playlist, for relative entries
+    ULONG dirLen = PathPart((STRPTR)filename) - (STRPTR)filename;
+
+    while (ok && FGets(file, line, sizeof(line))) {
+        ULONG len = strlen(line);
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) len--;
+        line[len] = '\0';
+
+        if (len == 0 || line[0] == '#') continue;
+
+        // Absolute if it names a volume, assign or URL
+        if (strchr(line, ':') || dirLen == 0 || dirLen >= sizeof(path)) {
+            ok = playlistAdd(pl, line);
+        } else {
+            CopyMem((APTR)filename, path, dirLen);
+            path[dirLen] = '\0';
+            ok = AddPart(path, line, sizeof(path)) && playlistAdd(pl, path);
+        }
+    }
+
+    Close(file);
+    return ok;
+}
+
+void playlistFree(struct Playlist *pl) {
+    for (ULONG i = 0; i < pl->count; i++) {
+        FreeVec(pl->names[i]);
+    }
+    if (pl->names) {
+        FreeVec(pl->names);
+    }
+    memset(pl, 0, sizeof(struct Playlist));
+}
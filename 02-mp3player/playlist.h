@@ -0,0 +1,24 @@
+#ifndef PLAYLIST_H
+#define PLAYLIST_H
+
+#include <exec/types.h>
+
+struct Playlist {
+    STRPTR *names;
+    ULONG count;
+    ULONG capacity;
+};
+
+// Returns TRUE if name ends in .m3u
+BOOL isM3U(const char *name);
+
+// Append a copy of name
+BOOL playlistAdd(struct Playlist *pl, const char *name);
+
+// Append every entry of an M3U file. Relative entries are taken relative
+// to the directory of the M3U file.
+BOOL playlistAddM3U(struct Playlist *pl, const char *filename);
+
+void playlistFree(struct Playlist *pl);
+
+#endif
@@ -0,0 +1,168 @@
+#include <dos/dos.h>
+#include <proto/exec.h>
+#include <proto/dos.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "replaygain.h"
+
+#define TRACK_GAIN_KEY "replaygain_track_gain"
+#define ID3_FRAME_MAX 256   // Larger TXXX frames cannot be a gain
+#define APE_TAG_MAX 8192
+#define APE_FOOTER_SIZE 32
+#define ID3V1_SIZE 128
+
+static BOOL keyMatches(const char *key, ULONG len) {
+    if (len != sizeof(TRACK_GAIN_KEY) - 1) return FALSE;
+
+    for (ULONG i = 0; i < len; i++) {
+        if ((key[i] | 0x20) != TRACK_GAIN_KEY[i] && key[i] != TRACK_GAIN_KEY[i]) return FALSE;
+    }
+    return TRUE;
+}
+
+static ULONG getLE32(const UBYTE *p) {
+    return ((ULONG)p[3] << 24) | ((ULONG)p[2] << 16) | ((ULONG)p[1] << 8) | p[0];
+}
+
+static ULONG getBE32(const UBYTE *p) {
+    return ((ULONG)p[0] << 24) | ((ULONG)p[1] << 16) | ((ULONG)p[2] << 8) | p[3];
+}
+
+static ULONG getSyncsafe(const UBYTE *p) {
+    return ((ULONG)(p[0] & 0x7f) << 21) | ((ULONG)(p[1] & 0x7f) << 14) |
+           ((ULONG)(p[2] & 0x7f) << 7) | (p[3] & 0x7f);
+}
+
+LONG parseGain(const char *text) {
+    double db = atof(text);
+    return (LONG)(db * 100 + (db < 0 ? -0.5 : 0.5));
+}
+
+WORD gainFactor(LONG centiDb) {
+    if (centiDb > GAIN_MAX_CDB) centiDb = GAIN_MAX_CDB;
+
+    LONG factor = (LONG)(pow(10.0, centiDb / 2000.0) * GAIN_UNITY + 0.5);
+    return (WORD)(factor > 32767 ? 32767 : factor);
+}
+
+// TXXX frames of an ID3v2.3/2.4 tag at the start of the file
+static BOOL fromID3v2(BPTR file, LONG *centiDb) {
+    UBYTE header[10];
+
+    if (Read(file, header, 10) != 10 || memcmp(header, "ID3", 3) != 0) return FALSE;
+
+    UBYTE version = header[3];
+    if (version < 3 || version > 4) return FALSE;
+
+    ULONG end = 10 + getSyncsafe(header + 6);
+    ULONG pos = 10;
+
+    // Extended header
+    if (header[5] & 0x40) {
+        UBYTE ext[4];
+        if (Read(file, ext, 4) != 4) return FALSE;
+        // v2.4 counts the size field itself, v2.3 does not
+        pos += version == 4 ? getSyncsafe(ext) : getBE32(ext) + 4;
+        Seek(file, pos, OFFSET_BEGINNING);
+    }
+
+    while (pos + 10 <= end) {
+        UBYTE frame[10];
+        char data[ID3_FRAME_MAX + 1];
+
+        if (Read(file, frame, 10) != 10 || frame[0] == 0) break;
+        pos += 10;
+
+        ULONG size = version == 4 ? getSyncsafe(frame + 4) : getBE32(frame + 4);
+
+        // Only single byte encodings: ISO-8859-1 and UTF-8
+        if (memcmp(frame, "TXXX", 4) == 0 && size <= ID3_FRAME_MAX && size > 1) {
+            if (Read(file, data, size) != (LONG)size) break;
+            data[size] = '\0';
+
+            if (data[0] == 0 || data[0] == 3) {
+                const char *desc = data + 1;
+                ULONG descLen = strlen(desc);
+                if (descLen + 2 <= size && keyMatches(desc, descLen)) {
+                    *centiDb = parseGain(desc + descLen + 1);
+                    return TRUE;
+                }
+            }
+        } else if (Seek(file, pos + size, OFFSET_BEGINNING) == -1) {
+            break;
+        }
+        pos += size;
+    }
+    return FALSE;
+}
+
+// APEv2 tag at the end of the file, as written by mp3gain
+static BOOL fromAPEv2(BPTR file, LONG *centiDb) {
+    UBYTE footer[APE_FOOTER_SIZE];
+    UBYTE tag[3];
+    BOOL found = FALSE;
+
+    // Seek() returns the old position, so a second call gives the size
+    Seek(file, 0, OFFSET_END);
+    LONG fileSize = Seek(file, 0, OFFSET_END);
+    if (fileSize < APE_FOOTER_SIZE) return FALSE;
+
+    // The APE tag sits before an ID3v1 tag if there is one
+    LONG end = fileSize;
+    if (fileSize >= ID3V1_SIZE && Seek(file, fileSize - ID3V1_SIZE, OFFSET_BEGINNING) != -1 &&
+        Read(file, tag, 3) == 3 && memcmp(tag, "TAG", 3) == 0) {
+        end -= ID3V1_SIZE;
+    }
+
+    if (Seek(file, end - APE_FOOTER_SIZE, OFFSET_BEGINNING) == -1 ||
+        Read(file, footer, APE_FOOTER_SIZE) != APE_FOOTER_SIZE ||
+        memcmp(footer, "APETAGEX", 8) != 0) return FALSE;
+
+    ULONG size = getLE32(footer + 12) - APE_FOOTER_SIZE;
+    ULONG items = getLE32(footer + 16);
+    if (size == 0 || size > APE_TAG_MAX) return FALSE;
+
+    UBYTE *data = AllocMem(size + 1, MEMF_ANY);
+    if (!data) return FALSE;
+
+    if (Seek(file, end - APE_FOOTER_SIZE - size, OFFSET_BEGINNING) != -1 &&
+        Read(file, data, size) == (LONG)size) {
+        data[size] = '\0';
+
+        ULONG pos = 0;
+        for (ULONG i = 0; i < items && pos + 8 < size; i++) {
+            ULONG valueLen = getLE32(data + pos);
+            const char *key = (const char *)data + pos + 8;
+            ULONG keyLen = strlen(key);
+            ULONG value = pos + 8 + keyLen + 1;
+
+            if (value + valueLen > size) break;
+
+            if (keyMatches(key, keyLen)) {
+                char text[32];
+                ULONG len = valueLen < sizeof(text) - 1 ? valueLen : sizeof(text) - 1;
+                CopyMem(data + value, text, len);
+                text[len] = '\0';
+                *centiDb = parseGain(text);
+                found = TRUE;
+                break;
+            }
+            pos = value + valueLen;
+        }
+    }
+
+    FreeMem(data, size + 1);
+    return found;
+}
+
+BOOL readReplayGain(const char *filename, LONG *centiDb) {
+    BPTR file = Open((CONST_STRPTR)filename, MODE_OLDFILE);
+    if (!file) return FALSE;
+
+    BOOL found = fromID3v2(file, centiDb) || fromAPEv2(file, centiDb);
+
+    Close(file);
+    return found;
+}
@@ -0,0 +1,21 @@
+#ifndef REPLAYGAIN_H
+#define REPLAYGAIN_H
+
+#include <exec/types.h>
+
+// Gains are applied as Q12 factors in the interleave loop
+#define GAIN_SHIFT 12
+#define GAIN_UNITY (1 << GAIN_SHIFT)
+#define GAIN_MAX_CDB 1800 // +18 dB, the largest factor a WORD holds
+
+// Read REPLAYGAIN_TRACK_GAIN from the ID3v2 or APEv2 tag of a file, in
+// hundredths of a dB. FALSE if the file has none.
+BOOL readReplayGain(const char *filename, LONG *centiDb);
+
+// Q12 factor for a gain in hundredths of a dB, clamped to GAIN_MAX_CDB
+WORD gainFactor(LONG centiDb);
+
+// Parse "-6.54 dB" style values into hundredths of a dB
+LONG parseGain(const char *text);
+
+#endif
@@ -0,0 +1,175 @@
+#include <exec/memory.h>
+#include <proto/exec.h>
+#include <string.h>
+#include <math.h>
+
+#include "resample.h"
+#include "replaygain.h"
+
+struct FilterShape {
+    UWORD taps;
+    UWORD phases;
+};
+
+static const struct FilterShape shapes[] = {
+    {2, 64},    // RESAMPLE_FAST
+    {8, 64},    // RESAMPLE_MEDIUM
+    {16, 256}   // RESAMPLE_HIGH
+};
+
+static double sinc(double x) {
+    if (x == 0.0) return 1.0;
+    return sin(M_PI * x) / (M_PI * x);
+}
+
+// Blackman windowed sinc, cut off below the lower of the two Nyquist
+// frequencies. Every phase is normalized to unity DC gain so the fixed
+// point sum cannot drift.
+static void buildFilter(struct Resampler *rs) {
+    double cutoff = rs->outRate < rs->inRate ? 0.95 * rs->outRate / rs->inRate : 0.95;
+    WORD centre = rs->taps / 2 - 1;
+
+    for (UWORD p = 0; p < rs->phases; p++) {
+        double f = (double)p / rs->phases;
+        double h[16];
+        double sum = 0.0;
+
+        for (UWORD k = 0; k < rs->taps; k++) {
+            double x = k - centre - f;
+
+            if (rs->taps == 2) {
+                h[k] = k == 0 ? 1.0 - f : f;
+            } else {
+                double w = 0.42 + 0.5 * cos(2 * M_PI * x / rs->taps) +
+                           0.08 * cos(4 * M_PI * x / rs->taps);
+                h[k] = cutoff * sinc(cutoff * x) * w;
+            }
+            sum += h[k];
+        }
+
+        WORD *c = rs->coeffs + p * rs->taps;
+        for (UWORD k = 0; k < rs->taps; k++) {
+            c[k] = (WORD)floor(h[k] / sum * (1 << RESAMPLE_COEF_SHIFT) + 0.5);
+        }
+    }
+}
+
+BOOL resamplerInit(struct Resampler *rs, LONG inRate, LONG outRate, WORD channels,
+                   WORD quality, LONG maxInput) {
+    resamplerFree(rs);
+
+    rs->inRate = inRate;
+    rs->outRate = outRate;
+    rs->channels = channels;
+    if (inRate == outRate || channels > RESAMPLE_MAX_CHANNELS) return inRate == outRate;
+
+    if (quality < RESAMPLE_FAST) quality = RESAMPLE_FAST;
+    if (quality > RESAMPLE_HIGH) quality = RESAMPLE_HIGH;
+
+    rs->taps = shapes[quality].taps;
+    rs->phases = shapes[quality].phases;
+    rs->stepInt = inRate / outRate;
+    rs->stepFrac = inRate % outRate;
+    rs->phaseScale = ((ULONG)rs->phases << 16) / outRate;
+    rs->maxInput = maxInput;
+
+    rs->coeffs = AllocMem(rs->phases * rs->taps * sizeof(WORD), MEMF_ANY);
+    if (!rs->coeffs) return FALSE;
+
+    for (WORD ch = 0; ch < channels; ch++) {
+        rs->history[ch] = AllocMem((rs->taps + maxInput) * sizeof(WORD), MEMF_ANY);
+        if (!rs->history[ch]) {
+            resamplerFree(rs);
+            return FALSE;
+        }
+    }
+
+    buildFilter(rs);
+    resamplerReset(rs);
+    return TRUE;
+}
+
+void resamplerFree(struct Resampler *rs) {
+    if (rs->coeffs) {
+        FreeMem(rs->coeffs, rs->phases * rs->taps * sizeof(WORD));
+    }
+    for (WORD ch = 0; ch < RESAMPLE_MAX_CHANNELS; ch++) {
+        if (rs->history[ch]) {
+            FreeMem(rs->history[ch], (rs->taps + rs->maxInput) * sizeof(WORD));
+        }
+    }
+    memset(rs, 0, sizeof(*rs));
+}
+
+void resamplerReset(struct Resampler *rs) {
+    if (!rs->coeffs) return;
+
+    // Lead in with silence so the first output lines up with the first
+    // input sample instead of the filter delay eating it
+    rs->fill = rs->taps / 2 - 1;
+    rs->pos = 0;
+    rs->frac = 0;
+    for (WORD ch = 0; ch < rs->channels; ch++) {
+        memset(rs->history[ch], 0, rs->taps * sizeof(WORD));
+    }
+}
+
+ULONG resamplerMaxOutput(const struct Resampler *rs, LONG count) {
+    if (!rs->coeffs) return count;
+    return (ULONG)(((unsigned long long)count * rs->outRate + rs->inRate - 1) / rs->inRate) + 1;
+}
+
+// Kept to a plain loop over contiguous arrays so it compiles to MULS.W
+// on the 68000 and vectorizes where the compiler can
+static inline LONG dot(const WORD *s, const WORD *c, UWORD taps) {
+    LONG acc = 0;
+    for (UWORD k = 0; k < taps; k++) {
+        acc += (LONG)s[k] * c[k];
+    }
+    return acc;
+}
+
+ULONG resamplerProcess(struct Resampler *rs, WORD **input, LONG count, WORD *out, WORD gain) {
+    WORD *dst = out;
+    UWORD taps = rs->taps;
+
+    for (WORD ch = 0; ch < rs->channels; ch++) {
+        CopyMem(input[ch], rs->history[ch] + rs->fill, count * sizeof(WORD));
+    }
+    rs->fill += count;
+
+    while (rs->pos + taps <= rs->fill) {
+        const WORD *c = rs->coeffs + ((rs->frac * rs->phaseScale) >> 16) * taps;
+
+        for (WORD ch = 0; ch < rs->channels; ch++) {
+            LONG sample = dot(rs->history[ch] + rs->pos, c, taps) >> RESAMPLE_COEF_SHIFT;
+            if (gain != GAIN_UNITY) sample = (sample * gain) >> GAIN_SHIFT;
+
+            if (sample > 32767) sample = 32767;
+            else if (sample < -32768) sample = -32768;
+            *dst++ = (WORD)sample;
+        }
+
+        rs->pos += rs->stepInt;
+        rs->frac += rs->stepFrac;
+        if (rs->frac >= (ULONG)rs->outRate) {
+            rs->frac -= rs->outRate;
+            rs->pos++;
+        }
+    }
+
+    // Keep the samples the next outputs still need
+    if (rs->pos >= rs->fill) {
+        rs->pos -= rs->fill;
+        rs->fill = 0;
+    } else {
+        LONG keep = rs->fill - rs->pos;
+        for (WORD ch = 0; ch < rs->channels; ch++) {
+            memmove(rs->history[ch], rs->history[ch] + rs->pos, keep * sizeof(WORD));
+        }
+        rs->fill = keep;
+        rs->pos = 0;
+    }
+
+    return dst - out;
+}
@@ -0,0 +1,51 @@
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+#include <exec/types.h>
+
+#define RESAMPLE_FAST   0 // Linear interpolation
+#define RESAMPLE_MEDIUM 1 // 8 tap windowed sinc
+#define RESAMPLE_HIGH   2 // 16 tap windowed sinc, finer phase steps
+
+#define RESAMPLE_MAX_CHANNELS 2
+#define RESAMPLE_COEF_SHIFT 14
+
+// Polyphase sample rate converter working in 16 bit fixed point. Input
+// is planar as MPEGA returns it, output interleaved for the sink.
+struct Resampler {
+    LONG inRate;
+    LONG outRate;
+    WORD channels;
+    UWORD taps;             // Filter length per phase
+    UWORD phases;
+    WORD *coeffs;           // phases * taps, Q14
+
+    // Input position advances by stepInt + stepFrac / outRate per output
+    ULONG stepInt;
+    ULONG stepFrac;
+    ULONG frac;
+    ULONG phaseScale;       // frac * phaseScale >> 16 gives the phase
+    LONG pos;               // First tap of the next output in history
+    LONG fill;              // Samples held in history
+    LONG maxInput;
+
+    WORD *history[RESAMPLE_MAX_CHANNELS];
+};
+
+// Prepare a converter for blocks of up to maxInput samples per channel.
+// Rates that already match leave it inactive (coeffs NULL).
+BOOL resamplerInit(struct Resampler *rs, LONG inRate, LONG outRate, WORD channels,
+                   WORD quality, LONG maxInput);
+void resamplerFree(struct Resampler *rs);
+
+// Forget buffered input, e.g. after a seek
+void resamplerReset(struct Resampler *rs);
+
+// Output samples produced by at most count input samples
+ULONG resamplerMaxOutput(const struct Resampler *rs, LONG count);
+
+// Convert count samples per channel into out, applying a Q12 gain with
+// saturation. Returns the number of WORDs written.
+ULONG resamplerProcess(struct Resampler *rs, WORD **input, LONG count, WORD *out, WORD gain);
+
+#endif
@@ -0,0 +1,120 @@
+#include <dos/dos.h>
+#include <exec/memory.h>
+#include <proto/exec.h>
+#include <proto/dos.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "resample.h"
+#include "replaygain.h"
+#include "timer_util.h"
+
+// Converts BENCH_SECONDS of a stereo sine at common MP3 rates to the
+// output rate with each quality setting. CPU cost is reported as percent
+// of realtime, quality as SNR against the exact sine at the output rate.
+#define BENCH_SECONDS 10
+#define BLOCK 1152
+#define TONE_HZ 1000
+#define AMPLITUDE 16000.0
+#define SETTLE 64 // Output samples skipped while the filter fills
+#define OUTPUT_SIZE ((BLOCK * 96000 / 8000 + 2) * 2)
+
+static const LONG inputRates[] = {22050, 32000, 48000};
+static const char *qualityNames[] = {"fast", "medium", "high"};
+
+static const char *USAGE = "Usage: %s [<output rate>]\n";
+static const char *HEADER = "Input   Output  Quality  CPU %    SNR dB\n";
+static const char *RESULT = "%-7ld %-7ld %-8s %3ld.%02ld  %3ld.%ld\n";
+static const char *NO_TIMER = "Unable to open timer.device\n";
+static const char *NO_MEMORY = "Not enough memory\n";
+
+static WORD *input[RESAMPLE_MAX_CHANNELS];
+static WORD *output;
+
+static void runBench(LONG inRate, LONG outRate, WORD quality) {
+    struct Resampler rs = {0};
+    struct EClockVal start, end;
+    ULONG micros = 0;
+    double signal = 0.0, noise = 0.0;
+    ULONG produced = 0;
+    double phase = 0.0;
+    double step = 2 * M_PI * TONE_HZ / inRate;
+
+    if (!resamplerInit(&rs, inRate, outRate, 2, quality, BLOCK)) {
+        PutStr((STRPTR)NO_MEMORY);
+        return;
+    }
+
+    for (LONG done = 0; done < inRate * BENCH_SECONDS; done += BLOCK) {
+        for (LONG i = 0; i < BLOCK; i++) {
+            input[0][i] = input[1][i] = (WORD)(sin(phase) * AMPLITUDE);
+            phase += step;
+        }
+
+        timerNow(&start);
+        ULONG count = resamplerProcess(&rs, input, BLOCK, output, GAIN_UNITY) / 2;
+        timerNow(&end);
+        micros += timerMicros(&start, &end);
+
+        // Output sample n lines up with input time n / outRate
+        for (ULONG i = 0; i < count; i++, produced++) {
+            if (produced < SETTLE) continue;
+
+            double expected = sin(2 * M_PI * TONE_HZ * produced / outRate) * AMPLITUDE;
+            double error = output[i * 2] - expected;
+            signal += expected * expected;
+            noise += error * error;
+        }
+    }
+
+    resamplerFree(&rs);
+
+    ULONG load = micros / BENCH_SECONDS / 100;  // hundredths of a percent
+    LONG snr = noise > 0.0 ? (LONG)(100.0 * log10(signal / noise)) : 999;
+
+    LONG args[] = {inRate, outRate, (LONG)qualityNames[quality], (LONG)(load / 100),
+                   (LONG)(load % 100), snr / 10, snr % 10};
+    VPrintf((STRPTR)RESULT, (LONG *)args);
+}
+
+int main(int argc, char **argv) {
+    LONG outRate = argc > 1 ? atol(argv[1]) : 44100;
+    int rc = RETURN_OK;
+
+    if (argc > 2 || outRate < 8000 || outRate > 96000) {
+        LONG args[] = {(LONG)argv[0]};
+        VPrintf((STRPTR)USAGE, (LONG *)args);
+        return RETURN_FAIL;
+    }
+
+    if (!timerOpen()) {
+        PutStr((STRPTR)NO_TIMER);
+        return RETURN_FAIL;
+    }
+
+    input[0] = AllocMem(BLOCK * sizeof(WORD), MEMF_ANY);
+    input[1] = AllocMem(BLOCK * sizeof(WORD), MEMF_ANY);
+    output = AllocMem(OUTPUT_SIZE * sizeof(WORD), MEMF_ANY);
+
+    if (!input[0] || !input[1] || !output) {
+        PutStr((STRPTR)NO_MEMORY);
+        rc = RETURN_FAIL;
+    } else {
+        PutStr((STRPTR)HEADER);
+        for (UWORD r = 0; r < sizeof(inputRates) / sizeof(inputRates[0]); r++) {
+            if (inputRates[r] == outRate) continue;
+
+            for (WORD q = RESAMPLE_FAST; q <= RESAMPLE_HIGH; q++) {
+                if (SetSignal(0, SIGBREAKF_CTRL_C) & SIGBREAKF_CTRL_C) break;
+                runBench(inputRates[r], outRate, q);
+            }
+        }
+    }
+
+    if (output) FreeMem(output, OUTPUT_SIZE * sizeof(WORD));
+    if (input[1]) FreeMem(input[1], BLOCK * sizeof(WORD));
+    if (input[0]) FreeMem(input[0], BLOCK * sizeof(WORD));
+
+    timerClose();
+    return rc;
+}
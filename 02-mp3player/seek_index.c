@@ -0,0 +1,442 @@
+#include <dos/dos.h>
+#include <dos/dosextens.h>
+#include <exec/memory.h>
+#include <proto/exec.h>
+#include <proto/dos.h>
+#include <string.h>
+
+#include "include/libraries/mpega.h"
+#include "include/clib/mpega_protos.h"
+#include "seek_index.h"
+
+#define SCAN_BUFFER_SIZE 32768
+#define XING_TOC_SIZE 100
+#define CRC_POLY 0xEDB88320UL
+
+struct FrameInfo {
+    ULONG length;       // Bytes including header
+    UWORD samples;      // Samples per channel
+    UWORD mpeg1;
+    UWORD mono;
+    ULONG frequency;
+};
+
+// kbps by [MPEG-1 ? 0 : 1][layer - 1][index]
+static const UWORD bitrates[2][3][16] = {
+    {
+        {0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448, 0},
+        {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 0},
+        {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0}
+    },
+    {
+        {0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256, 0},
+        {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0},
+        {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0}
+    }
+};
+
+// Hz by [version bits][index], version 1 is reserved
+static const UWORD frequencies[4][3] = {
+    {11025, 12000, 8000},
+    {0, 0, 0},
+    {22050, 24000, 16000},
+    {44100, 48000, 32000}
+};
+
+static ULONG crcTable[256];
+
+static ULONG crc32(ULONG crc, const void *data, ULONG length) {
+    const UBYTE *p = data;
+
+    if (crcTable[1] == 0) {
+        for (ULONG n = 0; n < 256; n++) {
+            ULONG c = n;
+            for (UWORD k = 0; k < 8; k++) c = c & 1 ? CRC_POLY ^ (c >> 1) : c >> 1;
+            crcTable[n] = c;
+        }
+    }
+
+    crc = ~crc & 0xFFFFFFFFUL;
+    while (length--) {
+        crc = crcTable[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc & 0xFFFFFFFFUL;
+}
+
+// Covers the header up to the checksum itself, then the table
+static ULONG indexChecksum(const struct SeekIndexHeader *header, const ULONG *offsets) {
+    ULONG crc = crc32(0, header, sizeof(*header) - sizeof(header->checksum));
+    return crc32(crc, offsets, header->count * sizeof(ULONG));
+}
+
+static ULONG getBE32(const UBYTE *p) {
+    return ((ULONG)p[0] << 24) | ((ULONG)p[1] << 16) | ((ULONG)p[2] << 8) | p[3];
+}
+
+static UWORD getBE16(const UBYTE *p) {
+    return (UWORD)((p[0] << 8) | p[1]);
+}
+
+static BOOL parseHeader(const UBYTE *h, struct FrameInfo *info) {
+    if (h[0] != 0xff || (h[1] & 0xe0) != 0xe0) return FALSE;
+
+    UWORD version = (h[1] >> 3) & 3;
+    UWORD layer = 4 - ((h[1] >> 1) & 3);
+    UWORD rateIndex = h[2] >> 4;
+    UWORD freqIndex = (h[2] >> 2) & 3;
+    UWORD padding = (h[2] >> 1) & 1;
+
+    if (version == 1 || layer == 4 || rateIndex == 0 || rateIndex == 15 || freqIndex == 3) {
+        return FALSE;
+    }
+
+    info->mpeg1 = version == 3;
+    info->mono = (h[3] >> 6) == 3;
+    info->frequency = frequencies[version][freqIndex];
+
+    ULONG bitrate = bitrates[info->mpeg1 ? 0 : 1][layer - 1][rateIndex] * 1000UL;
+
+    if (layer == 1) {
+        info->samples = 384;
+        info->length = (12 * bitrate / info->frequency + padding) * 4;
+    } else if (layer == 2 || info->mpeg1) {
+        info->samples = 1152;
+        info->length = 144 * bitrate / info->frequency + padding;
+    } else {
+        info->samples = 576;
+        info->length = 72 * bitrate / info->frequency + padding;
+    }
+    return TRUE;
+}
+
+// Bytes to skip for an ID3v2 tag at the start of the file
+static ULONG id3v2Size(const UBYTE *buf, LONG len) {
+    if (len < 10 || buf[0] != 'I' || buf[1] != 'D' || buf[2] != '3') return 0;
+
+    ULONG size = ((ULONG)(buf[6] & 0x7f) << 21) | ((ULONG)(buf[7] & 0x7f) << 14) |
+                 ((ULONG)(buf[8] & 0x7f) << 7) | (buf[9] & 0x7f);
+    return size + 10 + ((buf[5] & 0x10) ? 10 : 0);
+}
+
+static BOOL addEntry(struct SeekIndex *idx, ULONG *capacity, ULONG offset) {
+    if (idx->header.count == *capacity) {
+        ULONG newCapacity = *capacity ? *capacity * 2 : 256;
+        ULONG *offsets = AllocVec(newCapacity * sizeof(ULONG), MEMF_ANY);
+        if (!offsets) return FALSE;
+
+        if (idx->offsets) {
+            CopyMem(idx->offsets, offsets, idx->header.count * sizeof(ULONG));
+            FreeVec(idx->offsets);
+        }
+        idx->offsets = offsets;
+        *capacity = newCapacity;
+    }
+
+    idx->offsets[idx->header.count++] = offset;
+
+    // Keep the table compact on long files: drop every other entry
+    if (idx->header.count > SEEK_MAX_ENTRIES) {
+        ULONG n = 0;
+        for (ULONG i = 0; i < idx->header.count; i += 2) {
+            idx->offsets[n++] = idx->offsets[i];
+        }
+        idx->header.count = n;
+        idx->header.intervalMs *= 2;
+    }
+    return TRUE;
+}
+
+// Fill the table by interpolating between (ms, offset) anchor points taken
+// from a VBR header TOC
+static BOOL fromAnchors(struct SeekIndex *idx, const ULONG *anchorMs, const ULONG *anchorOffset,
+                        ULONG anchors, ULONG durationMs) {
+    ULONG capacity = 0;
+    ULONG a = 0;
+
+    // Duration is known up front, so pick the final resolution now
+    while (durationMs / idx->header.intervalMs >= SEEK_MAX_ENTRIES) {
+        idx->header.intervalMs *= 2;
+    }
+
+    for (ULONG t = 0; t < durationMs; t += idx->header.intervalMs) {
+        while (a + 2 < anchors && anchorMs[a + 1] <= t) a++;
+
+        ULONG span = anchorMs[a + 1] - anchorMs[a];
+        ULONG offset = anchorOffset[a];
+        if (span) {
+            offset += (ULONG)((unsigned long long)(anchorOffset[a + 1] - anchorOffset[a]) *
+                              (t - anchorMs[a]) / span);
+        }
+
+        if (!addEntry(idx, &capacity, offset)) return FALSE;
+    }
+    return idx->header.count > 0;
+}
+
+// Xing/Info header of a VBR file
+static BOOL fromXing(struct SeekIndex *idx, const UBYTE *frame, const struct FrameInfo *info,
+                     ULONG frameOffset, ULONG fileSize) {
+    ULONG sideInfo = info->mpeg1 ? (info->mono ? 17 : 32) : (info->mono ? 9 : 17);
+    const UBYTE *x = frame + 4 + sideInfo;
+
+    if (memcmp(x, "Xing", 4) != 0 && memcmp(x, "Info", 4) != 0) return FALSE;
+
+    ULONG flags = getBE32(x + 4);
+    const UBYTE *p = x + 8;
+    ULONG frames = 0;
+    ULONG bytes = fileSize - frameOffset;
+
+    if (!(flags & 1) || !(flags & 4)) return FALSE;
+    frames = getBE32(p);
+    p += 4;
+    if (flags & 2) {
+        bytes = getBE32(p);
+        p += 4;
+    }
+
+    ULONG durationMs = (ULONG)((unsigned long long)frames * info->samples * 1000 / info->frequency);
+    ULONG anchorMs[XING_TOC_SIZE + 1];
+    ULONG anchorOffset[XING_TOC_SIZE + 1];
+
+    for (UWORD i = 0; i < XING_TOC_SIZE; i++) {
+        anchorMs[i] = (ULONG)((unsigned long long)durationMs * i / XING_TOC_SIZE);
+        anchorOffset[i] = frameOffset + (ULONG)((unsigned long long)p[i] * bytes / 256);
+    }
+    anchorMs[XING_TOC_SIZE] = durationMs;
+    anchorOffset[XING_TOC_SIZE] = frameOffset + bytes;
+
+    idx->header.source = SEEK_SOURCE_XING;
+    return fromAnchors(idx, anchorMs, anchorOffset, XING_TOC_SIZE + 1, durationMs);
+}
+
+// Fraunhofer VBRI header, always 32 bytes after the frame header
+static BOOL fromVBRI(struct SeekIndex *idx, const UBYTE *frame, LONG avail,
+                     const struct FrameInfo *info, ULONG frameOffset) {
+    const UBYTE *v = frame + 36;
+
+    if (avail < 36 + 26 || memcmp(v, "VBRI", 4) != 0) return FALSE;
+
+    ULONG frames = getBE32(v + 14);
+    UWORD entries = getBE16(v + 18);
+    UWORD scale = getBE16(v + 20);
+    UWORD entrySize = getBE16(v + 22);
+    UWORD framesPerEntry = getBE16(v + 24);
+    const UBYTE *toc = v + 26;
+
+    if (entries == 0 || entrySize < 1 || entrySize > 4 ||
+        avail < 36 + 26 + (LONG)entries * entrySize) return FALSE;
+
+    ULONG *anchorMs = AllocVec((entries + 1) * 2 * sizeof(ULONG), MEMF_ANY);
+    if (!anchorMs) return FALSE;
+    ULONG *anchorOffset = anchorMs + entries + 1;
+
+    ULONG offset = frameOffset;
+    for (UWORD i = 0; i <= entries; i++) {
+        ULONG frame = (ULONG)i * framesPerEntry;
+        if (frame > frames) frame = frames;
+
+        anchorMs[i] = (ULONG)((unsigned long long)frame * info->samples * 1000 / info->frequency);
+        anchorOffset[i] = offset;
+
+        if (i < entries) {
+            ULONG size = 0;
+            for (UWORD b = 0; b < entrySize; b++) size = (size << 8) | toc[i * entrySize + b];
+            offset += size * scale;
+        }
+    }
+
+    ULONG durationMs = (ULONG)((unsigned long long)frames * info->samples * 1000 / info->frequency);
+
+    idx->header.source = SEEK_SOURCE_VBRI;
+    BOOL ok = fromAnchors(idx, anchorMs, anchorOffset, entries + 1, durationMs);
+    FreeVec(anchorMs);
+    return ok;
+}
+
+// Walk every frame header, recording the frame starting each interval
+static BOOL scanFrames(struct SeekIndex *idx, BPTR file, UBYTE *buf, ULONG start) {
+    ULONG capacity = 0;
+    ULONG bufStart = 0;
+    LONG bufLen = 0;
+    ULONG pos = start;
+    ULONG frequency = 0;
+    unsigned long long samples = 0;
+    struct FrameInfo info;
+
+    idx->header.source = SEEK_SOURCE_SCAN;
+
+    for (;;) {
+        if (pos < bufStart || pos + 4 > bufStart + bufLen) {
+            if (Seek(file, pos, OFFSET_BEGINNING) == -1) break;
+            bufLen = Read(file, buf, SCAN_BUFFER_SIZE);
+            bufStart = pos;
+            if (bufLen < 4) break;
+        }
+
+        UBYTE *h = buf + (pos - bufStart);
+        LONG avail = bufStart + bufLen - pos;
+
+        if (!parseHeader(h, &info) || (frequency && info.frequency != frequency)) {
+            // Lost sync (tag, garbage, false sync): look further on
+            LONG sync = MPEGA_find_sync((BYTE *)h + 1, avail - 1);
+            pos += sync >= 0 ? (ULONG)sync + 1 : (ULONG)avail - 3;
+            continue;
+        }
+        frequency = info.frequency;
+
+        ULONG ms = (ULONG)(samples * 1000 / frequency);
+        while (ms >= idx->header.count * idx->header.intervalMs) {
+            if (!addEntry(idx, &capacity, pos)) return FALSE;
+        }
+
+        samples += info.samples;
+        pos += info.length;
+    }
+
+    return idx->header.count > 0;
+}
+
+static BOOL buildIndex(struct SeekIndex *idx, BPTR file) {
+    UBYTE *buf = AllocMem(SCAN_BUFFER_SIZE, MEMF_ANY);
+    if (!buf) return FALSE;
+
+    BOOL ok = FALSE;
+    LONG len = Read(file, buf, SCAN_BUFFER_SIZE);
+    ULONG start = id3v2Size(buf, len);
+
+    if (start) {
+        Seek(file, start, OFFSET_BEGINNING);
+        len = Read(file, buf, SCAN_BUFFER_SIZE);
+    }
+
+    // First frame, which may carry a VBR header
+    LONG sync = len >= 4 ? MPEGA_find_sync((BYTE *)buf, len) : MPEGA_ERR_NO_SYNC;
+    struct FrameInfo info;
+
+    if (sync >= 0 && sync + 4 <= len && parseHeader(buf + sync, &info)) {
+        ULONG frameOffset = start + sync;
+        LONG avail = len - sync;
+
+        if (avail >= 4 + 32 + 8 + 4 + 4 + XING_TOC_SIZE) {
+            ok = fromXing(idx, buf + sync, &info, frameOffset, idx->header.fileSize);
+        }
+        if (!ok) {
+            ok = fromVBRI(idx, buf + sync, avail, &info, frameOffset);
+        }
+        if (!ok) {
+            idx->header.count = 0;
+            idx->header.intervalMs = SEEK_INTERVAL_MS;
+            ok = scanFrames(idx, file, buf, frameOffset);
+        }
+    }
+
+    FreeMem(buf, SCAN_BUFFER_SIZE);
+    return ok;
+}
+
+// Offsets must stay inside the file and never go backwards
+static BOOL validOffsets(const struct SeekIndexHeader *header, const ULONG *offsets) {
+    for (ULONG i = 0; i < header->count; i++) {
+        if (offsets[i] >= header->fileSize || (i > 0 && offsets[i] < offsets[i - 1])) return FALSE;
+    }
+    return TRUE;
+}
+
+static BOOL loadCache(struct SeekIndex *idx, const char *cacheName) {
+    struct SeekIndexHeader header;
+    BOOL ok = FALSE;
+
+    BPTR file = Open((CONST_STRPTR)cacheName, MODE_OLDFILE);
+    if (!file) return FALSE;
+
+    if (Read(file, &header, sizeof(header)) == sizeof(header) &&
+        header.magic == SEEK_INDEX_MAGIC &&
+        header.version == SEEK_INDEX_VERSION &&
+        header.fileSize == idx->header.fileSize &&
+        CompareDates(&header.fileDate, &idx->header.fileDate) == 0 &&
+        header.intervalMs > 0 &&
+        header.count > 0 && header.count <= SEEK_MAX_ENTRIES) {
+
+        LONG size = header.count * sizeof(ULONG);
+        idx->offsets = AllocVec(size, MEMF_ANY);
+        if (idx->offsets && Read(file, idx->offsets, size) == size &&
+            indexChecksum(&header, idx->offsets) == header.checksum &&
+            validOffsets(&header, idx->offsets)) {
+            idx->header = header;
+            ok = TRUE;
+        } else if (idx->offsets) {
+            FreeVec(idx->offsets);
+            idx->offsets = NULL;
+        }
+    }
+
+    Close(file);
+    return ok;
+}
+
+static void saveCache(const struct SeekIndex *idx, const char *cacheName) {
+    BPTR file = Open((CONST_STRPTR)cacheName, MODE_NEWFILE);
+    if (!file) return; // Read-only media, the table just is not kept
+
+    struct SeekIndexHeader header = idx->header;
+    header.checksum = indexChecksum(&header, idx->offsets);
+
+    LONG size = header.count * sizeof(ULONG);
+    BOOL ok = Write(file, &header, sizeof(header)) == sizeof(header) &&
+              Write(file, idx->offsets, size) == size;
+    Close(file);
+
+    if (!ok) DeleteFile((CONST_STRPTR)cacheName);
+}
+
+BOOL seekIndexOpen(struct SeekIndex *idx, const char *filename) {
+    char cacheName[256];
+    BOOL ok = FALSE;
+
+    memset(idx, 0, sizeof(struct SeekIndex));
+    idx->header.magic = SEEK_INDEX_MAGIC;
+    idx->header.version = SEEK_INDEX_VERSION;
+    idx->header.intervalMs = SEEK_INTERVAL_MS;
+
+    if (strlen(filename) + sizeof(SEEK_INDEX_SUFFIX) > sizeof(cacheName)) return FALSE;
+    strcpy(cacheName, filename);
+    strcat(cacheName, SEEK_INDEX_SUFFIX);
+
+    BPTR file = Open((CONST_STRPTR)filename, MODE_OLDFILE);
+    if (!file) return FALSE;
+
+    struct FileInfoBlock *fib = AllocDosObject(DOS_FIB, NULL);
+    if (fib && ExamineFH(file, fib)) {
+        idx->header.fileSize = fib->fib_Size;
+        idx->header.fileDate = fib->fib_Date;
+
+        ok = loadCache(idx, cacheName);
+        if (!ok && buildIndex(idx, file)) {
+            saveCache(idx, cacheName);
+            ok = TRUE;
+        }
+    }
+
+    if (fib) FreeDosObject(DOS_FIB, fib);
+    Close(file);
+
+    if (!ok) seekIndexFree(idx);
+    return ok;
+}
+
+LONG seekIndexLookup(const struct SeekIndex *idx, ULONG *ms) {
+    if (!idx->offsets || idx->header.count == 0 || idx->header.intervalMs == 0) return -1;
+
+    ULONG i = *ms / idx->header.intervalMs;
+    if (i >= idx->header.count) i = idx->header.count - 1;
+
+    *ms = i * idx->header.intervalMs;
+    return (LONG)idx->offsets[i];
+}
+
+void seekIndexFree(struct SeekIndex *idx) {
+    if (idx->offsets) {
+        FreeVec(idx->offsets);
+    }
+    memset(idx, 0, sizeof(struct SeekIndex));
+}
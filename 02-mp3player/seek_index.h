@@ -0,0 +1,45 @@
+#ifndef SEEK_INDEX_H
+#define SEEK_INDEX_H
+
+#include <exec/types.h>
+#include <dos/dos.h>
+
+#define SEEK_INDEX_MAGIC   0x53494458 // 'SIDX'
+#define SEEK_INDEX_VERSION 2
+#define SEEK_INDEX_SUFFIX  ".sidx"    // Sidecar next to the MP3 file
+#define SEEK_INTERVAL_MS   1000       // Starting table resolution
+#define SEEK_MAX_ENTRIES   4096       // Resolution halves beyond this
+
+// Where the table came from
+#define SEEK_SOURCE_SCAN 0
+#define SEEK_SOURCE_XING 1
+#define SEEK_SOURCE_VBRI 2
+
+struct SeekIndexHeader {
+    ULONG magic;
+    UWORD version;
+    UWORD source;
+    ULONG fileSize;             // Cache key, with fileDate
+    struct DateStamp fileDate;
+    ULONG intervalMs;           // offsets[i] is the frame at i * intervalMs
+    ULONG count;
+    ULONG checksum;             // CRC-32 of the fields above and the offsets
+};
+
+struct SeekIndex {
+    struct SeekIndexHeader header;
+    ULONG *offsets;
+};
+
+// Load the cached table for filename, or build it from a Xing/VBRI TOC or
+// a frame header scan and write the cache. A cache that fails its checks
+// is rebuilt.
+BOOL seekIndexOpen(struct SeekIndex *idx, const char *filename);
+
+// Byte offset of the frame at or before *ms, -1 if none. *ms is moved
+// back to the time of that frame.
+LONG seekIndexLookup(const struct SeekIndex *idx, ULONG *ms);
+
+void seekIndexFree(struct SeekIndex *idx);
+
+#endif
@@ -0,0 +1,188 @@
+#include <devices/ahi.h>
+#include <dos/dos.h>
+#include <exec/memory.h>
+#include <proto/exec.h>
+#include <proto/dos.h>
+#include <proto/ahi.h>
+
+#include "audio_sink.h"
+#include "player_stats.h"
+#include "timer_util.h"
+
+// AHI structures
+static struct MsgPort *AHImp = NULL;
+static struct AHIRequest *AHIios[2] = {NULL, NULL};
+static struct AHIRequest *AHIio = NULL;
+static APTR AHIiocopy = NULL;
+static BYTE AHIDevice = -1;
+
+// Request still playing from the previous submit()
+static struct AHIRequest *link = NULL;
+static BOOL pending[2] = {FALSE, FALSE};
+static UWORD current = 0;
+
+// Queue model for statistics: audio submitted since the queue last ran dry
+static struct EClockVal queueStart;
+static ULONG queuedFrames = 0;
+
+static const char *UNABLE_TO_OPEN = "Unable to open %s/0 version 4\n";
+
+static void ahiClose(struct AudioSink *sink) {
+    (void)sink;
+
+    for (int i = 0; i < 2; i++) {
+        if (pending[i]) {
+            AbortIO((struct IORequest *)AHIios[i]);
+            WaitIO((struct IORequest *)AHIios[i]);
+            pending[i] = FALSE;
+        }
+    }
+    link = NULL;
+
+    if (!AHIDevice) {
+        CloseDevice((struct IORequest *)AHIio);
+        AHIDevice = -1;
+    }
+    if (AHIio) {
+        DeleteIORequest((struct IORequest *)AHIio);
+        AHIio = NULL;
+    }
+    if (AHIiocopy) {
+        FreeMem(AHIiocopy, sizeof(struct AHIRequest));
+        AHIiocopy = NULL;
+    }
+    if (AHImp) {
+        DeleteMsgPort(AHImp);
+        AHImp = NULL;
+    }
+}
+
+static BOOL ahiOpen(struct AudioSink *sink, const char *target) {
+    (void)target;
+
+    AHImp = CreateMsgPort();
+    if (!AHImp) return FALSE;
+
+    AHIio = (struct AHIRequest *)CreateIORequest(AHImp, sizeof(struct AHIRequest));
+    if (!AHIio) return FALSE;
+
+    AHIio->ahir_Version = 4;
+    AHIDevice = OpenDevice((STRPTR)AHINAME, 0, (struct IORequest *)AHIio, 0);
+    if (AHIDevice) {
+        LONG args[] = {(LONG)AHINAME};
+        VPrintf((STRPTR)UNABLE_TO_OPEN, (LONG *)args);
+        return FALSE;
+    }
+
+    AHIiocopy = AllocMem(sizeof(struct AHIRequest), MEMF_ANY);
+    if (!AHIiocopy) return FALSE;
+
+    CopyMem(AHIio, AHIiocopy, sizeof(struct AHIRequest));
+    AHIios[0] = AHIio;
+    AHIios[1] = (struct AHIRequest *)AHIiocopy;
+
+    link = NULL;
+    current = 0;
+    sink->framesWritten = 0;
+    return TRUE;
+}
+
+static WORD *ahiGetBuffer(struct AudioSink *sink) {
+    return sink->buffers[current];
+}
+
+static void playBuffer(struct AudioSink *sink, WORD *buffer, ULONG length,
+                       struct AHIRequest *req) {
+    req->ahir_Std.io_Message.mn_Node.ln_Pri = 0;
+    req->ahir_Std.io_Command = CMD_WRITE;
+    req->ahir_Std.io_Data = buffer;
+    req->ahir_Std.io_Length = length * sizeof(WORD);
+    req->ahir_Std.io_Offset = 0;
+    req->ahir_Frequency = sink->frequency;
+    req->ahir_Type = sink->channels == 2 ? AHIST_S16S : AHIST_M16S;
+    req->ahir_Volume = 0x10000;
+    req->ahir_Position = 0x8000;
+    req->ahir_Link = link;
+
+    SendIO((struct IORequest *)req);
+}
+
+// Record how much audio is still queued ahead of this submit
+static void recordFill(struct AudioSink *sink, ULONG length) {
+    struct EClockVal now;
+    BOOL underrun = link && CheckIO((struct IORequest *)link);
+
+    timerNow(&now);
+    if (!link || underrun) {
+        queueStart = now;
+        queuedFrames = 0;
+    }
+
+    LONG fillMs = (LONG)((unsigned long long)queuedFrames * 1000 / sink->frequency) -
+                  (LONG)timerMillis(&queueStart, &now);
+    statsSubmit(fillMs > 0 ? fillMs : 0, underrun);
+
+    queuedFrames += length / sink->channels;
+}
+
+static BOOL ahiSubmit(struct AudioSink *sink, WORD *buffer, ULONG length) {
+    struct AHIRequest *req = AHIios[current];
+    struct EClockVal waitStart, waitEnd;
+
+    if (stats.enabled) recordFill(sink, length);
+
+    playBuffer(sink, buffer, length, req);
+    pending[current] = TRUE;
+    sink->framesWritten += length / sink->channels;
+
+    // Double buffering: wait for the previous request before reusing it
+    if (link) {
+        if (stats.enabled) timerNow(&waitStart);
+
+        ULONG signals = Wait(SIGBREAKF_CTRL_C | (1L << AHImp->mp_SigBit));
+
+        if (signals & SIGBREAKF_CTRL_C) {
+            SetIoErr(ERROR_BREAK);
+            return FALSE;
+        }
+
+        BYTE err = WaitIO((struct IORequest *)link);
+        pending[current ^ 1] = FALSE;
+
+        if (stats.enabled) {
+            timerNow(&waitEnd);
+            statsWait(timerMicros(&waitStart, &waitEnd));
+        }
+
+        if (err) {
+            SetIoErr(ERROR_WRITE_PROTECTED);
+            return FALSE;
+        }
+    }
+
+    link = req;
+    current ^= 1;
+    return TRUE;
+}
+
+static void ahiDrain(struct AudioSink *sink) {
+    (void)sink;
+
+    for (int i = 0; i < 2; i++) {
+        if (pending[i]) {
+            WaitIO((struct IORequest *)AHIios[i]);
+            pending[i] = FALSE;
+        }
+    }
+    link = NULL;
+}
+
+struct AudioSink ahiSink = {
+    .name = "ahi",
+    .variableRate = TRUE,
+    .open = ahiOpen,
+    .getBuffer = ahiGetBuffer,
+    .submit = ahiSubmit,
+    .drain = ahiDrain,
+    .close = ahiClose
+};
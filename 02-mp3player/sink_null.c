@@ -0,0 +1,68 @@
+#include <dos/dos.h>
+#include <proto/exec.h>
+#include <proto/dos.h>
+
+#include "audio_sink.h"
+#include "timer_util.h"
+
+// Discards audio as fast as it is decoded and reports the realtime factor
+static struct EClockVal startTime;
+static BOOL timing = FALSE;
+
+static const char *REALTIME = "Decoded %ld ms of audio in %ld ms (%ld.%02ld x realtime)\n";
+
+static BOOL nullOpen(struct AudioSink *sink, const char *target) {
+    (void)target;
+
+    sink->framesWritten = 0;
+    timing = timerOpen();
+    if (timing) timerNow(&startTime);
+    return TRUE;
+}
+
+static WORD *nullGetBuffer(struct AudioSink *sink) {
+    return sink->buffers[0];
+}
+
+static BOOL nullSubmit(struct AudioSink *sink, WORD *buffer, ULONG length) {
+    (void)buffer;
+
+    sink->framesWritten += length / sink->channels;
+
+    // Nothing blocks here, so poll for the break
+    if (SetSignal(0, SIGBREAKF_CTRL_C) & SIGBREAKF_CTRL_C) {
+        SetIoErr(ERROR_BREAK);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static void nullDrain(struct AudioSink *sink) {
+    (void)sink;
+}
+
+static void nullClose(struct AudioSink *sink) {
+    if (!timing) return;
+
+    struct EClockVal now;
+    timerNow(&now);
+
+    ULONG wallMs = timerMillis(&startTime, &now);
+    ULONG audioMs = (ULONG)((unsigned long long)sink->framesWritten * 1000 / sink->frequency);
+    ULONG factor = wallMs ? (ULONG)((unsigned long long)audioMs * 100 / wallMs) : 0;
+
+    LONG args[] = {(LONG)audioMs, (LONG)wallMs, (LONG)(factor / 100), (LONG)(factor % 100)};
+    VPrintf((STRPTR)REALTIME, (LONG *)args);
+
+    timerClose();
+    timing = FALSE;
+}
+
+struct AudioSink nullSink = {
+    .name = "null",
+    .open = nullOpen,
+    .getBuffer = nullGetBuffer,
+    .submit = nullSubmit,
+    .drain = nullDrain,
+    .close = nullClose
+};
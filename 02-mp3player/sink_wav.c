@@ -0,0 +1,112 @@
+#include <dos/dos.h>
+#include <proto/exec.h>
+#include <proto/dos.h>
+
+#include "audio_sink.h"
+
+#define WAV_HEADER_SIZE 44
+
+// Writes a 16-bit PCM RIFF/WAVE file
+static BPTR wavFile = 0;
+static ULONG dataBytes = 0;
+
+static const char *CANNOT_CREATE = "Unable to create %s\n";
+
+static void putLE16(UBYTE *p, UWORD v) {
+    p[0] = v & 0xff;
+    p[1] = v >> 8;
+}
+
+static void putLE32(UBYTE *p, ULONG v) {
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+    p[2] = (v >> 16) & 0xff;
+    p[3] = v >> 24;
+}
+
+static BOOL writeHeader(struct AudioSink *sink) {
+    UBYTE h[WAV_HEADER_SIZE];
+    UWORD blockAlign = sink->channels * sizeof(WORD);
+
+    CopyMem("RIFF", h, 4);
+    putLE32(h + 4, 36 + dataBytes);
+    CopyMem("WAVEfmt ", h + 8, 8);
+    putLE32(h + 16, 16);
+    putLE16(h + 20, 1); // PCM
+    putLE16(h + 22, sink->channels);
+    putLE32(h + 24, sink->frequency);
+    putLE32(h + 28, sink->frequency * blockAlign);
+    putLE16(h + 32, blockAlign);
+    putLE16(h + 34, 16);
+    CopyMem("data", h + 36, 4);
+    putLE32(h + 40, dataBytes);
+
+    return Write(wavFile, h, WAV_HEADER_SIZE) == WAV_HEADER_SIZE;
+}
+
+static BOOL wavOpen(struct AudioSink *sink, const char *target) {
+    sink->framesWritten = 0;
+    dataBytes = 0;
+
+    wavFile = Open((CONST_STRPTR)target, MODE_NEWFILE);
+    if (!wavFile) {
+        LONG args[] = {(LONG)target};
+        VPrintf((STRPTR)CANNOT_CREATE, (LONG *)args);
+        return FALSE;
+    }
+
+    // Sizes are patched in on close
+    return writeHeader(sink);
+}
+
+static WORD *wavGetBuffer(struct AudioSink *sink) {
+    return sink->buffers[0];
+}
+
+static BOOL wavSubmit(struct AudioSink *sink, WORD *buffer, ULONG length) {
+    // Convert to little endian in place, the buffer is ours until the
+    // next getBuffer()
+    UBYTE *bytes = (UBYTE *)buffer;
+    for (ULONG i = 0; i < length; i++) {
+        UWORD s = (UWORD)buffer[i];
+        bytes[2 * i] = s & 0xff;
+        bytes[2 * i + 1] = s >> 8;
+    }
+
+    LONG size = length * sizeof(WORD);
+    if (Write(wavFile, buffer, size) != size) {
+        return FALSE;
+    }
+
+    dataBytes += size;
+    sink->framesWritten += length / sink->channels;
+
+    if (SetSignal(0, SIGBREAKF_CTRL_C) & SIGBREAKF_CTRL_C) {
+        SetIoErr(ERROR_BREAK);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static void wavDrain(struct AudioSink *sink) {
+    (void)sink;
+}
+
+static void wavClose(struct AudioSink *sink) {
+    if (!wavFile) return;
+
+    if (Seek(wavFile, 0, OFFSET_BEGINNING) != -1) {
+        writeHeader(sink);
+    }
+    Close(wavFile);
+    wavFile = 0;
+}
+
+struct AudioSink wavSink = {
+    .name = "wav",
+    .open = wavOpen,
+    .getBuffer = wavGetBuffer,
+    .submit = wavSubmit,
+    .drain = wavDrain,
+    .close = wavClose
+};
@@ -0,0 +1,149 @@
+// Stand-in Icecast server for tunebench, built for the development machine
+// (see the "host" target in the Makefile). Every request, whatever its
+// path, gets an ICY response and the MP3 file in a loop: first -burst bytes
+// at once, as Icecast's burst-on-connect does, then paced to -kbps. Each
+// listener is served by its own process.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define CHUNK 1024
+#define MAX_FILE (16 * 1024 * 1024)
+
+struct ServerOptions {
+    const char *file;
+    int port;
+    long burst;
+    long kbps;
+};
+
+static struct ServerOptions opts = {NULL, 8000, 65536, 128};
+
+static unsigned char *data;
+static long dataSize;
+
+static long long nowMicros(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (long long)t.tv_sec * 1000000 + t.tv_nsec / 1000;
+}
+
+static int parseArgs(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-port") == 0 && i + 1 < argc) {
+            opts.port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-burst") == 0 && i + 1 < argc) {
+            opts.burst = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-kbps") == 0 && i + 1 < argc) {
+            opts.kbps = atol(argv[++i]);
+        } else if (argv[i][0] == '-' || opts.file) {
+            return 0;
+        } else {
+            opts.file = argv[i];
+        }
+    }
+    return opts.file && opts.port > 0 && opts.burst >= 0 && opts.kbps > 0;
+}
+
+static int loadFile(void) {
+    FILE *in = fopen(opts.file, "rb");
+    if (!in) return 0;
+
+    data = malloc(MAX_FILE);
+    dataSize = data ? (long)fread(data, 1, MAX_FILE, in) : 0;
+    fclose(in);
+    return dataSize > 0;
+}
+
+// Skips the request headers, the path does not matter
+static int readRequest(int s) {
+    char c;
+    int newlines = 0;
+
+    while (newlines < 2) {
+        if (recv(s, &c, 1, 0) != 1) return 0;
+        if (c == '\n') newlines++;
+        else if (c != '\r') newlines = 0;
+    }
+    return 1;
+}
+
+static void serve(int s) {
+    char header[256];
+    long position = 0;
+    long long sent = 0;
+
+    if (!readRequest(s)) return;
+
+    snprintf(header, sizeof(header), "ICY 200 OK\r\nicy-name: streamserver\r\n"
+             "content-type: audio/mpeg\r\nicy-br: %ld\r\n\r\n", opts.kbps);
+    if (send(s, header, strlen(header), 0) < 0) return;
+
+    long long start = nowMicros();
+    for (;;) {
+        // Bytes the listener may have by now
+        long long due = opts.burst + (nowMicros() - start) * opts.kbps / 8000;
+        if (sent >= due) {
+            usleep(10000);
+            continue;
+        }
+
+        long length = dataSize - position < CHUNK ? dataSize - position : CHUNK;
+        if (send(s, data + position, length, 0) != length) return;
+
+        sent += length;
+        position = (position + length) % dataSize;
+    }
+}
+
+int main(int argc, char **argv) {
+    if (!parseArgs(argc, argv)) {
+        printf("Usage: %s [-port <n>] [-burst <bytes>] [-kbps <n>] <mp3file>\n", argv[0]);
+        return 1;
+    }
+    if (!loadFile()) {
+        printf("Could not read %s\n", opts.file);
+        return 1;
+    }
+
+    // Listeners hang up after their first buffer
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGCHLD, SIG_IGN);
+
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    int yes = 1;
+    struct sockaddr_in addr;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(opts.port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    if (listener < 0 || bind(listener, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(listener, 4) < 0) {
+        printf("Could not listen on port %d\n", opts.port);
+        return 1;
+    }
+
+    printf("Serving %s on port %d, %ld byte burst, then %ld kbps\n",
+           opts.file, opts.port, opts.burst, opts.kbps);
+
+    for (;;) {
+        int s = accept(listener, NULL, NULL);
+        if (s < 0) continue;
+
+        if (fork() == 0) {
+            close(listener);
+            serve(s);
+            _exit(0);
+        }
+        close(s);
+    }
+}
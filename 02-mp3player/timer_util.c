@@ -0,0 +1,50 @@
+#include <exec/memory.h>
+#include <devices/timer.h>
+#include <proto/exec.h>
+#include <proto/timer.h>
+
+#include "timer_util.h"
+
+struct Device *TimerBase = NULL;
+static struct timerequest timerIO;
+static ULONG eclockFreq = 0;
+static UWORD timerUsers = 0;
+
+BOOL timerOpen(void) {
+    if (timerUsers++) return TRUE;
+
+    if (OpenDevice((STRPTR)TIMERNAME, UNIT_ECLOCK, (struct IORequest *)&timerIO, 0)) {
+        timerUsers = 0;
+        return FALSE;
+    }
+    TimerBase = timerIO.tr_node.io_Device;
+
+    struct EClockVal t;
+    eclockFreq = ReadEClock(&t);
+    return TRUE;
+}
+
+void timerClose(void) {
+    if (timerUsers == 0 || --timerUsers) return;
+
+    CloseDevice((struct IORequest *)&timerIO);
+    TimerBase = NULL;
+}
+
+void timerNow(struct EClockVal *t) {
+    ReadEClock(t);
+}
+
+static unsigned long long ticks(const struct EClockVal *start, const struct EClockVal *end) {
+    unsigned long long a = ((unsigned long long)start->ev_hi << 32) | start->ev_lo;
+    unsigned long long b = ((unsigned long long)end->ev_hi << 32) | end->ev_lo;
+    return b - a;
+}
+
+ULONG timerMicros(const struct EClockVal *start, const struct EClockVal *end) {
+    return (ULONG)(ticks(start, end) * 1000000ULL / eclockFreq);
+}
+
+ULONG timerMillis(const struct EClockVal *start, const struct EClockVal *end) {
+    return (ULONG)(ticks(start, end) * 1000ULL / eclockFreq);
+}
@@ -0,0 +1,16 @@
+#ifndef TIMER_UTIL_H
+#define TIMER_UTIL_H
+
+#include <exec/types.h>
+#include <devices/timer.h>
+
+// E-clock based timing for benchmarks and statistics
+BOOL timerOpen(void);
+void timerClose(void);
+void timerNow(struct EClockVal *t);
+
+// Elapsed time between two timerNow() readings
+ULONG timerMicros(const struct EClockVal *start, const struct EClockVal *end);
+ULONG timerMillis(const struct EClockVal *start, const struct EClockVal *end);
+
+#endif
@@ -0,0 +1,329 @@
+#include <dos/dos.h>
+#include <exec/memory.h>
+#include <proto/exec.h>
+#include <proto/dos.h>
+#include <clib/alib_protos.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "include/libraries/mpega.h"
+#include "include/clib/mpega_protos.h"
+#include "http_stream.h"
+#include "file_stream.h"
+#include "audio_sink.h"
+#include "timer_util.h"
+#include "../01-xmlparsing/radio.h"
+
+// Time to audio: from picking a station by name to the first buffer handed
+// to the sink, split into the steps radiosearch and mp3player take.
+//   Lookup   find_station() in radio.idx, radio.spx and radio.bin
+//   Connect  bitstream open: connect, HTTP request, jitter buffer prefill
+//   Stream   the rest of MPEGA_open(), finding the first frame header
+//   Decode   MPEGA_decode_frame() until it returns samples
+//   Sink     sink open, for AHI the device and the first request
+//   Submit   interleaving and the first submit(), SendIO() for AHI
+// Run it in the directory radioparser wrote the catalog to. -server sends
+// the station's request to a stand-in such as streamserver instead of the
+// host in its listen_url.
+#define BIN_FILE "radio.bin"
+#define IDX_FILE "radio.idx"
+#define SPX_FILE "radio.spx"
+#define MAX_RUNS 20
+#define MAX_URL 256
+#define FIRST_FRAMES 8  // Layer III may return empty frames first
+
+enum { STAGE_LOOKUP, STAGE_CONNECT, STAGE_STREAM, STAGE_DECODE, STAGE_SINK, STAGE_SUBMIT,
+       STAGE_TOTAL, STAGES };
+
+struct BenchOptions {
+    const char *sinkName;
+    const char *outFile;
+    const char *server;     // host:port replacing the one in listen_url
+    LONG runs;
+    const char *station;
+};
+
+static struct BenchOptions opts = {"null", "out.wav", NULL, 3, NULL};
+
+struct Library *MPEGABase = NULL;
+static struct AudioSink *sink = NULL;
+static WORD *pcmBuffers[MPEGA_MAX_CHANNELS];
+static WORD *outputBuffers[SINK_BUFFERS];
+static char stationName[64];
+static char url[MAX_URL];
+
+// The bitstream hook MPEGA_open() calls goes through timingHook, which
+// measures the open call of the real one
+static struct Hook streamHook;
+static struct Hook timingHook;
+static ULONG connectMicros;
+
+static ULONG micros[MAX_RUNS][STAGES];
+
+#define PCM_BYTES (MPEGA_PCM_SIZE * sizeof(WORD))
+#define OUTPUT_WORDS (MPEGA_PCM_SIZE * MPEGA_MAX_CHANNELS)
+
+static const char *USAGE = "Usage: %s [-sink ahi|null|wav] [-o <wavfile>] [-server <host:port>]\n"
+                            "          [-runs <n>] <station name>\n";
+static const char *STATION = "Station: %s\nURL: %s\n";
+static const char *HEADER = "\nRun    Lookup   Connect    Stream    Decode      Sink    Submit     Total\n";
+static const char *RUN = "%3ld";
+static const char *TIMES = "%8ld.%ld";
+static const char *SUMMARY = "Time to audio: first %ld.%ld ms, best %ld.%ld ms, average %ld.%ld ms\n";
+static const char *CANNOT_OPEN = "Unable to play %s\n";
+static const char *NO_AUDIO = "No audio decoded from %s\n";
+static const char *FAILED_TO_INIT = "Failed to initialize %s output\n";
+static const char *NO_MEMORY = "Not enough memory\n";
+static const char *MPEGA_FAILED = "Failed to initialize MPEGA library\n";
+static const char *NO_TIMER = "Unable to open timer.device\n";
+
+static BOOL parseArgs(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-sink") == 0 && i + 1 < argc) {
+            opts.sinkName = argv[++i];
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            opts.outFile = argv[++i];
+        } else if (strcmp(argv[i], "-server") == 0 && i + 1 < argc) {
+            opts.server = argv[++i];
+        } else if (strcmp(argv[i], "-runs") == 0 && i + 1 < argc) {
+            opts.runs = atol(argv[++i]);
+            if (opts.runs < 1 || opts.runs > MAX_RUNS) return FALSE;
+        } else if (argv[i][0] == '-' || opts.station) {
+            return FALSE;
+        } else {
+            opts.station = argv[i];
+        }
+    }
+
+    sink = findSink(opts.sinkName);
+    return opts.station && sink;
+}
+
+static ULONG __saveds timingHookFunc(struct Hook *hook, APTR handle, MPEGA_ACCESS *access) {
+    struct EClockVal start, end;
+    (void)hook;
+
+    if (access->func != MPEGA_BSFUNC_OPEN) return CallHookPkt(&streamHook, handle, access);
+
+    timerNow(&start);
+    ULONG result = CallHookPkt(&streamHook, handle, access);
+    timerNow(&end);
+    connectMicros = timerMicros(&start, &end);
+    return result;
+}
+
+// Opened as mp3player opens a playlist entry
+static MPEGA_STREAM *openStream(const char *name) {
+    MPEGA_CTRL ctrl = {
+        NULL,
+        { FALSE, { 1, MPEGA_QUALITY_HIGH, 44100 }, { 1, MPEGA_QUALITY_HIGH, 44100 } },
+        { FALSE, { 1, MPEGA_QUALITY_HIGH, 44100 }, { 1, MPEGA_QUALITY_HIGH, 44100 } },
+        0,
+        32768
+    };
+
+    if (isHttpUrl(name)) {
+        initHttpHook(&streamHook);
+    } else {
+        initFileHook(&streamHook);
+    }
+
+    memset(&timingHook, 0, sizeof(timingHook));
+    timingHook.h_Entry = (HOOKFUNC)HookEntry;
+    timingHook.h_SubEntry = (HOOKFUNC)timingHookFunc;
+    ctrl.bs_access = &timingHook;
+
+    connectMicros = 0;
+    return MPEGA_open((char *)name, &ctrl);
+}
+
+// listen_url, or its path on opts.server
+static void stationUrl(const char *listenUrl) {
+    if (!opts.server || !isHttpUrl(listenUrl)) {
+        strncpy(url, listenUrl, MAX_URL - 1);
+        return;
+    }
+
+    const char *path = strchr(listenUrl + 7, '/');
+    strcpy(url, "http://");
+    strncat(url, opts.server, MAX_URL - 64);
+    strncat(url, path ? path : "/", MAX_URL - strlen(url) - 1);
+}
+
+static ULONG lap(struct EClockVal *mark) {
+    struct EClockVal now;
+    timerNow(&now);
+
+    ULONG elapsed = timerMicros(mark, &now);
+    *mark = now;
+    return elapsed;
+}
+
+static ULONG interleave(WORD *buffer, LONG count, WORD channels) {
+    WORD *dst = buffer;
+
+    for (LONG i = 0; i < count; i++) {
+        for (WORD ch = 0; ch < channels; ch++) {
+            *dst++ = pcmBuffers[ch][i];
+        }
+    }
+    return count * channels;
+}
+
+// One lookup and playback start, filling in times. Buffers are allocated
+// up front: the player carves them from a pool, which costs next to nothing.
+static BOOL runOnce(ULONG *times) {
+    struct EClockVal start, mark;
+    MPEGA_STREAM *stream;
+    BOOL sinkOpen = FALSE;
+    BOOL success = FALSE;
+    LONG samples = 0;
+
+    timerNow(&start);
+    mark = start;
+
+    struct RadioEntry *entry = find_station(opts.station, IDX_FILE, SPX_FILE, BIN_FILE);
+    times[STAGE_LOOKUP] = lap(&mark);
+    if (!entry) return FALSE;
+    CopyMem(entry->server_name, stationName, sizeof(stationName) - 1);
+    stationUrl(entry->listen_url);
+
+    stream = openStream(url);
+    ULONG openMicros = lap(&mark);
+    times[STAGE_CONNECT] = connectMicros;
+    times[STAGE_STREAM] = openMicros > connectMicros ? openMicros - connectMicros : 0;
+    if (!stream) {
+        LONG args[] = {(LONG)url};
+        VPrintf((STRPTR)CANNOT_OPEN, (LONG *)args);
+        return FALSE;
+    }
+
+    for (int i = 0; i < FIRST_FRAMES && samples == 0; i++) {
+        samples = MPEGA_decode_frame(stream, pcmBuffers);
+    }
+    times[STAGE_DECODE] = lap(&mark);
+    if (samples <= 0) {
+        LONG args[] = {(LONG)url};
+        VPrintf((STRPTR)NO_AUDIO, (LONG *)args);
+        goto done;
+    }
+
+    sink->frequency = stream->dec_frequency;
+    sink->channels = stream->dec_channels;
+    sink->buffers[0] = outputBuffers[0];
+    sink->buffers[1] = outputBuffers[1];
+    sink->bufferSize = OUTPUT_WORDS;
+
+    sinkOpen = sink->open(sink, opts.outFile);
+    times[STAGE_SINK] = lap(&mark);
+    if (!sinkOpen) {
+        LONG args[] = {(LONG)sink->name};
+        VPrintf((STRPTR)FAILED_TO_INIT, (LONG *)args);
+        goto done;
+    }
+
+    WORD *buffer = sink->getBuffer(sink);
+    ULONG length = interleave(buffer, samples, stream->dec_channels);
+    success = sink->submit(sink, buffer, length);
+    times[STAGE_SUBMIT] = lap(&mark);
+    times[STAGE_TOTAL] = timerMicros(&start, &mark);
+
+done:
+    if (sinkOpen) sink->close(sink);
+    MPEGA_close(stream);
+    return success;
+}
+
+static void printMillis(const char *format, ULONG us) {
+    LONG args[] = {(LONG)(us / 1000), (LONG)(us / 100 % 10)};
+    VPrintf((STRPTR)format, (LONG *)args);
+}
+
+static void report(LONG runs) {
+    ULONG best = micros[0][STAGE_TOTAL];
+    unsigned long long sum = 0;
+
+    LONG station[] = {(LONG)stationName, (LONG)url};
+    VPrintf((STRPTR)STATION, (LONG *)station);
+
+    PutStr((STRPTR)HEADER);
+    for (LONG run = 0; run < runs; run++) {
+        LONG args[] = {run + 1};
+        VPrintf((STRPTR)RUN, (LONG *)args);
+        for (int stage = 0; stage < STAGES; stage++) {
+            printMillis(TIMES, micros[run][stage]);
+        }
+        PutStr((STRPTR)"\n");
+
+        if (micros[run][STAGE_TOTAL] < best) best = micros[run][STAGE_TOTAL];
+        sum += micros[run][STAGE_TOTAL];
+    }
+
+    ULONG first = micros[0][STAGE_TOTAL];
+    ULONG average = (ULONG)(sum / runs);
+    LONG args[] = {(LONG)(first / 1000), (LONG)(first / 100 % 10),
+                   (LONG)(best / 1000), (LONG)(best / 100 % 10),
+                   (LONG)(average / 1000), (LONG)(average / 100 % 10)};
+    VPrintf((STRPTR)SUMMARY, (LONG *)args);
+}
+
+static BOOL allocateBuffers(void) {
+    for (int ch = 0; ch < MPEGA_MAX_CHANNELS; ch++) {
+        pcmBuffers[ch] = AllocMem(PCM_BYTES, MEMF_PUBLIC);
+        if (!pcmBuffers[ch]) return FALSE;
+    }
+    for (int i = 0; i < SINK_BUFFERS; i++) {
+        outputBuffers[i] = AllocMem(OUTPUT_WORDS * sizeof(WORD), MEMF_PUBLIC);
+        if (!outputBuffers[i]) return FALSE;
+    }
+    return TRUE;
+}
+
+static void freeBuffers(void) {
+    for (int i = 0; i < SINK_BUFFERS; i++) {
+        if (outputBuffers[i]) FreeMem(outputBuffers[i], OUTPUT_WORDS * sizeof(WORD));
+    }
+    for (int ch = 0; ch < MPEGA_MAX_CHANNELS; ch++) {
+        if (pcmBuffers[ch]) FreeMem(pcmBuffers[ch], PCM_BYTES);
+    }
+}
+
+int main(int argc, char **argv) {
+    int rc = RETURN_FAIL;
+    LONG runs = 0;
+
+    if (!parseArgs(argc, argv)) {
+        LONG args[] = {(LONG)argv[0]};
+        VPrintf((STRPTR)USAGE, (LONG *)args);
+        return RETURN_FAIL;
+    }
+
+    if (!timerOpen()) {
+        PutStr((STRPTR)NO_TIMER);
+        return RETURN_FAIL;
+    }
+
+    MPEGABase = OpenLibrary("mpega.library", 0);
+    if (!MPEGABase) {
+        PutStr((STRPTR)MPEGA_FAILED);
+    } else if (!allocateBuffers()) {
+        PutStr((STRPTR)NO_MEMORY);
+    } else {
+        // Every run looks the station up again, so later ones show the
+        // catalog coming from the filesystem's buffers
+        while (runs < opts.runs && runOnce(micros[runs])) {
+            runs++;
+            if (SetSignal(0, SIGBREAKF_CTRL_C) & SIGBREAKF_CTRL_C) break;
+        }
+        if (runs) {
+            report(runs);
+            rc = RETURN_OK;
+        }
+    }
+
+    freeBuffers();
+    block_file_close();
+    if (MPEGABase) CloseLibrary(MPEGABase);
+    timerClose();
+    return rc;
+}